@@ -0,0 +1,329 @@
+#include "AsyncIO.h"
+#include <fstream>
+#include <iostream>
+
+#include "Profiler.h"
+
+#ifdef MAZE_HAVE_LIBURING
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct AsyncIO::Ring {
+    io_uring ring{};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Batch>> queue;
+    bool stopping{false};
+    bool initialised{false};
+    std::thread worker; //started once the ring is up
+
+    static constexpr unsigned DEPTH = 64; //submission queue entries, bigger batches go through in waves
+
+    ~Ring() {
+        {
+            const std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join(); //finishes whatever is queued first, so pending writes still land
+        }
+        if (initialised) {
+            io_uring_queue_exit(&ring);
+        }
+    }
+
+    void run() {
+        PROFILE_THREAD_NAME("io_uring");
+        std::unique_lock lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] {return stopping || !queue.empty();});
+            if (queue.empty()) {
+                return;
+            }
+            //take everything that's queued, it all goes in the same submission
+            std::vector<std::shared_ptr<Batch>> batches(std::make_move_iterator(queue.begin()),
+                                                        std::make_move_iterator(queue.end()));
+            queue.clear();
+            lock.unlock();
+            process(batches);
+            lock.lock();
+        }
+    }
+
+    void process(std::vector<std::shared_ptr<Batch>>& batches) {
+        PROFILE_SCOPE("io_uring batch");
+        struct Pending {
+            Job* job;
+            int fd;
+        };
+        //opens are still blocking, the ring does the reads and writes. all opened up front so the vector never
+        //moves while the kernel holds pointers into it
+        std::vector<Pending> pending;
+        for (const auto& batch : batches) {
+            for (Job& job : batch->jobs) {
+                const int fd = job.write
+                                   ? ::open(job.fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                                   : ::open(job.fileName.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                    std::cerr << "Error opening file for " << (job.write ? "writing: " : "reading: ") << job.fileName
+                              << std::endl;
+                    continue;
+                }
+                if (!job.write) {
+                    struct stat info{};
+                    if (fstat(fd, &info) != 0) {
+                        std::cerr << "Error reading file size: " << job.fileName << std::endl;
+                        ::close(fd);
+                        continue;
+                    }
+                    job.data.resize(static_cast<size_t>(info.st_size));
+                }
+                if (job.data.empty()) {
+                    job.ok = true; //nothing to transfer
+                    ::close(fd);
+                    continue;
+                }
+                pending.push_back({&job, fd});
+            }
+        }
+
+        size_t next = 0;
+        size_t inFlight = 0; //queued in the ring and not completed yet
+        std::vector<io_uring_sqe*> unsubmitted; //queued but the kernel hasn't taken them yet
+        const auto reap = [&](io_uring_cqe* cqe) {
+            //null data is a no-op left over from a failed submit, see below
+            if (const auto* done = static_cast<Pending*>(io_uring_cqe_get_data(cqe))) {
+                finish(*done->job, done->fd, cqe->res);
+                --inFlight;
+            }
+            io_uring_cqe_seen(&ring, cqe);
+        };
+        while (next < pending.size() || inFlight > 0) {
+            while (next < pending.size()) {
+                io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+                if (!sqe) {
+                    break; //ring's full, the rest go in the next wave
+                }
+                Job& job = *pending[next].job;
+                if (job.write) {
+                    io_uring_prep_write(sqe, pending[next].fd, job.data.data(), static_cast<unsigned>(job.data.size()), 0);
+                }
+                else {
+                    io_uring_prep_read(sqe, pending[next].fd, job.data.data(), static_cast<unsigned>(job.data.size()), 0);
+                }
+                io_uring_sqe_set_data(sqe, &pending[next]);
+                unsubmitted.push_back(sqe);
+                ++next;
+                ++inFlight;
+            }
+            const int submitted = io_uring_submit_and_wait(&ring, 1);
+            if (submitted >= 0) {
+                //the kernel takes them in order, anything it didn't goes with the next submit
+                unsubmitted.erase(unsubmitted.begin(),
+                                  unsubmitted.begin() + std::min<size_t>(submitted, unsubmitted.size()));
+            }
+            else if (submitted != -EINTR) {
+                std::cerr << "io_uring submit failed: " << std::strerror(-submitted) << std::endl;
+                //what the kernel never took is still in the submission queue and would go out with the next batch,
+                //pointing at buffers that are gone by then. make those no-ops
+                for (io_uring_sqe* sqe : unsubmitted) {
+                    io_uring_prep_nop(sqe);
+                    io_uring_sqe_set_data(sqe, nullptr);
+                }
+                inFlight -= unsubmitted.size();
+                unsubmitted.clear();
+                //the rest are the kernel's until they complete, the fds and buffers have to outlive them.
+                //jobs that never went in are left not ok
+                while (inFlight > 0) {
+                    io_uring_cqe* cqe = nullptr;
+                    const int waited = io_uring_wait_cqe(&ring, &cqe);
+                    if (waited == -EINTR) {
+                        continue;
+                    }
+                    if (waited < 0) {
+                        std::cerr << "io_uring wait failed: " << std::strerror(-waited) << std::endl;
+                        break;
+                    }
+                    reap(cqe);
+                }
+                break;
+            }
+            io_uring_cqe* cqe = nullptr;
+            while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+                reap(cqe);
+            }
+        }
+        for (const Pending& entry : pending) {
+            ::close(entry.fd);
+        }
+        for (const auto& batch : batches) {
+            batch->done(batch->jobs);
+        }
+    }
+
+    static void finish(Job& job, const int fd, const int result) {
+        if (result < 0) {
+            std::cerr << "Error " << (job.write ? "writing " : "reading ") << job.fileName << ": "
+                      << std::strerror(-result) << std::endl;
+            return;
+        }
+        //regular files basically never come back short, but if one does just finish it off here
+        auto transferred = static_cast<size_t>(result);
+        while (transferred < job.data.size()) {
+            const ssize_t more = job.write
+                                     ? ::pwrite(fd, job.data.data() + transferred, job.data.size() - transferred,
+                                                static_cast<off_t>(transferred))
+                                     : ::pread(fd, job.data.data() + transferred, job.data.size() - transferred,
+                                               static_cast<off_t>(transferred));
+            if (more <= 0) {
+                std::cerr << "Error " << (job.write ? "writing " : "reading ") << job.fileName << std::endl;
+                return;
+            }
+            transferred += static_cast<size_t>(more);
+        }
+        job.ok = true;
+    }
+
+    static std::unique_ptr<Ring> create() {
+        auto created = std::make_unique<Ring>();
+        const int error = io_uring_queue_init(DEPTH, &created->ring, 0);
+        if (error < 0) {
+            std::cerr << "io_uring unavailable (" << std::strerror(-error) << "), maze I/O falls back to threads"
+                      << std::endl;
+            return nullptr;
+        }
+        created->initialised = true;
+        created->worker = std::thread(&Ring::run, created.get());
+        return created;
+    }
+};
+#else
+struct AsyncIO::Ring {
+    static std::unique_ptr<Ring> create() {return nullptr;}
+};
+#endif
+
+AsyncIO::AsyncIO(const size_t threadCount) : ring(Ring::create()), pool(ring ? 0 : threadCount) {
+}
+
+AsyncIO::~AsyncIO() = default;
+
+std::future<AsyncIO::ReadResult> AsyncIO::read(std::string fileName) {
+    auto promise = std::make_shared<std::promise<ReadResult>>();
+    auto future = promise->get_future();
+    auto batch = std::make_shared<Batch>();
+    batch->jobs.push_back({false, std::move(fileName), {}, false});
+    batch->done = [promise](std::vector<Job>& jobs) {
+        promise->set_value({std::move(jobs[0].fileName), std::move(jobs[0].data), jobs[0].ok});
+    };
+    submit(std::move(batch));
+    return future;
+}
+
+std::future<bool> AsyncIO::write(std::string fileName, std::vector<uint8_t> data) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    auto batch = std::make_shared<Batch>();
+    batch->jobs.push_back({true, std::move(fileName), std::move(data), false});
+    batch->done = [promise](std::vector<Job>& jobs) {
+        promise->set_value(jobs[0].ok);
+    };
+    submit(std::move(batch));
+    return future;
+}
+
+std::future<std::vector<AsyncIO::ReadResult>> AsyncIO::readBatch(std::vector<std::string> fileNames) {
+    auto promise = std::make_shared<std::promise<std::vector<ReadResult>>>();
+    auto future = promise->get_future();
+    auto batch = std::make_shared<Batch>();
+    batch->jobs.reserve(fileNames.size());
+    for (auto& fileName : fileNames) {
+        batch->jobs.push_back({false, std::move(fileName), {}, false});
+    }
+    batch->done = [promise](std::vector<Job>& jobs) {
+        std::vector<ReadResult> results;
+        results.reserve(jobs.size());
+        for (Job& job : jobs) {
+            results.push_back({std::move(job.fileName), std::move(job.data), job.ok});
+        }
+        promise->set_value(std::move(results));
+    };
+    submit(std::move(batch));
+    return future;
+}
+
+std::future<size_t> AsyncIO::writeBatch(std::vector<WriteRequest> requests) {
+    auto promise = std::make_shared<std::promise<size_t>>();
+    auto future = promise->get_future();
+    auto batch = std::make_shared<Batch>();
+    batch->jobs.reserve(requests.size());
+    for (auto& request : requests) {
+        batch->jobs.push_back({true, std::move(request.fileName), std::move(request.data), false});
+    }
+    batch->done = [promise](std::vector<Job>& jobs) {
+        size_t written = 0;
+        for (const Job& job : jobs) {
+            written += job.ok;
+        }
+        promise->set_value(written);
+    };
+    submit(std::move(batch));
+    return future;
+}
+
+const char *AsyncIO::backendName() const {
+    return ring ? "io_uring" : "thread pool";
+}
+
+void AsyncIO::submit(std::shared_ptr<Batch> batch) {
+#ifdef MAZE_HAVE_LIBURING
+    if (ring) {
+        {
+            const std::lock_guard lock(ring->mutex);
+            ring->queue.push_back(std::move(batch));
+        }
+        ring->wake.notify_one();
+        return;
+    }
+#endif
+    //the batch's own promise carries the result, the pool's future isn't needed
+    pool.submit([batch] {
+        PROFILE_SCOPE("io batch");
+        for (Job& job : batch->jobs) {
+            runBlocking(job);
+        }
+        batch->done(batch->jobs);
+    });
+}
+
+void AsyncIO::runBlocking(Job &job) {
+    if (job.write) {
+        std::ofstream file{job.fileName, std::ios::binary};
+        if (!file) {
+            std::cerr << "Error opening file for writing: " << job.fileName << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(job.data.data()), static_cast<std::streamsize>(job.data.size()));
+        job.ok = static_cast<bool>(file);
+        return;
+    }
+    std::ifstream file{job.fileName, std::ios::binary | std::ios::ate};
+    if (!file) {
+        std::cerr << "Error opening file for reading: " << job.fileName << std::endl;
+        return;
+    }
+    job.data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(job.data.data()), static_cast<std::streamsize>(job.data.size()));
+    job.ok = static_cast<bool>(file);
+}
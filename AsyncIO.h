@@ -0,0 +1,68 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+ * whole file reads and writes off the calling thread, results come back as futures.
+ * on linux with liburing (cmake finds it, MAZE_ENABLE_IO_URING) everything goes through one io_uring: a batch of
+ * N files is one submission and one wait instead of N blocking calls. without it, or if the kernel says no to
+ * the ring (old kernel, some containers), batches run on a couple of io threads with plain blocking calls.
+ * either way the caller never blocks until it asks the future for the result
+ */
+
+class AsyncIO {
+public:
+    struct ReadResult {
+        std::string fileName;
+        std::vector<uint8_t> data;
+        bool ok{false};
+    };
+    struct WriteRequest {
+        std::string fileName;
+        std::vector<uint8_t> data;
+    };
+
+    explicit AsyncIO(size_t threadCount = 2);
+    ~AsyncIO();
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+
+    std::future<ReadResult> read(std::string fileName);
+    std::future<bool> write(std::string fileName, std::vector<uint8_t> data);
+    //one submission for the lot, results in the same order as the names
+    std::future<std::vector<ReadResult>> readBatch(std::vector<std::string> fileNames);
+    //resolves to how many of them made it to disk, failures get logged
+    std::future<size_t> writeBatch(std::vector<WriteRequest> requests);
+
+    [[nodiscard]] const char* backendName() const; //"io_uring" or "thread pool", for logs
+
+private:
+    struct Job {
+        bool write{false};
+        std::string fileName;
+        std::vector<uint8_t> data; //filled in for reads, what gets written for writes
+        bool ok{false};
+    };
+    struct Batch {
+        std::vector<Job> jobs;
+        std::function<void(std::vector<Job>&)> done; //called once every job has finished, on an io thread
+    };
+    struct Ring; //only exists in io_uring builds, kept out of the header so nothing else needs liburing
+
+    void submit(std::shared_ptr<Batch> batch);
+    static void runBlocking(Job& job);
+
+    std::unique_ptr<Ring> ring; //null when using the thread pool
+    ThreadPool pool; //no threads when the ring is up. last, same as the other thread owners
+};
+
+
+
+#endif //ASYNCIO_H
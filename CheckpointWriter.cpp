@@ -0,0 +1,157 @@
+#include "CheckpointWriter.h"
+#include "Profiler.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CheckpointWriter::CheckpointWriter() : worker(&CheckpointWriter::run, this) {
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    //finish whatever is pending before shutting down, losing the last snapshot defeats the point
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void CheckpointWriter::submit(const std::string& fileName, std::vector<char> data) {
+    {
+        std::lock_guard lock(mutex);
+        pending = Job{fileName, std::move(data)};
+    }
+    wake.notify_one();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] {return !pending && !writing;});
+}
+
+bool CheckpointWriter::getLastWriteOk() const {
+    std::lock_guard lock(mutex);
+    return lastWriteOk;
+}
+
+bool CheckpointWriter::writeAtomic(const std::string& fileName, const std::vector<char>& data) {
+    const std::string tempName = fileName + ".tmp";
+    //never leave a half written temp file lying around next to the real one
+    const auto fail = [&] {
+        std::error_code ignored;
+        std::filesystem::remove(tempName, ignored);
+        return false;
+    };
+    if (!writeSynced(tempName, data)) {
+        return fail();
+    }
+    //rename replaces the old file in one step, readers see either the old or the new snapshot
+    std::error_code error;
+    std::filesystem::rename(tempName, fileName, error);
+    if (error) {
+        std::cerr << "Error renaming " << tempName << " to " << fileName << ": " << error.message() << std::endl;
+        return fail();
+    }
+    //the rename lives in the directory, so it's only durable once that's synced too
+    if (!syncDirectory(std::filesystem::path(fileName).parent_path())) {
+        std::cerr << "Warning: couldn't sync the directory of " << fileName << ", the rename may not survive a crash"
+                  << std::endl;
+    }
+    return true;
+}
+
+bool CheckpointWriter::writeSynced(const std::string& fileName, const std::vector<char>& data) {
+#ifdef _WIN32
+    std::ofstream file{fileName, std::ios::binary | std::ios::trunc};
+    if (!file) {
+        std::cerr << "Error opening file for writing: " << fileName << std::endl;
+        return false;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.flush();
+    if (!file) {
+        std::cerr << "Error writing checkpoint: " << fileName << std::endl;
+        return false;
+    }
+    return true;
+#else
+    //straight through an fd so it can be fsynced, otherwise the rename can reach the disk before the data does
+    //and a crash leaves an empty or partial file under the real name
+    const int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error opening file for writing: " << fileName << std::endl;
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t more = ::write(fd, data.data() + written, data.size() - written);
+        if (more < 0 && errno == EINTR) {
+            continue;
+        }
+        if (more <= 0) {
+            std::cerr << "Error writing checkpoint: " << fileName << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(more);
+    }
+    const bool synced = ::fsync(fd) == 0;
+    const bool closed = ::close(fd) == 0;
+    if (!synced || !closed) {
+        std::cerr << "Error syncing checkpoint: " << fileName << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool CheckpointWriter::syncDirectory(const std::filesystem::path& directory) {
+#ifdef _WIN32
+    return true; //no way to sync a directory, and rename there is already as durable as it gets
+#else
+    const std::string name = directory.empty() ? "." : directory.string();
+    const int fd = ::open(name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#endif
+}
+
+void CheckpointWriter::run() {
+    PROFILE_THREAD_NAME("checkpoint writer");
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] {return pending || stopping;});
+        if (!pending) {
+            return; //stopping and nothing left to write
+        }
+        Job job = std::move(*pending);
+        pending.reset();
+        writing = true;
+
+        lock.unlock();
+        bool ok;
+        {
+            PROFILE_SCOPE("write checkpoint");
+            ok = writeAtomic(job.fileName, job.data);
+        }
+        lock.lock();
+
+        writing = false;
+        lastWriteOk = ok;
+        if (!pending) {
+            idle.notify_all();
+        }
+    }
+}
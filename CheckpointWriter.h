@@ -0,0 +1,54 @@
+#ifndef CHECKPOINTWRITER_H
+#define CHECKPOINTWRITER_H
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * writes snapshot files on a background thread so the caller never waits on the disk.
+ * every file goes to <name>.tmp first, is fsynced, and is renamed over the real one when it's complete (then the
+ * directory is synced so the rename sticks), so a crash or power cut mid write leaves the previous snapshot intact
+ * instead of a half written one. a failed write cleans its temp file up.
+ * if a new snapshot comes in while one is still pending, the pending one is dropped (latest wins)
+ */
+
+class CheckpointWriter {
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void submit(const std::string& fileName, std::vector<char> data);
+    void flush(); //blocks until everything submitted so far is on disk
+    [[nodiscard]] bool getLastWriteOk() const;
+
+    static bool writeAtomic(const std::string& fileName, const std::vector<char>& data);
+
+private:
+    void run();
+    static bool writeSynced(const std::string& fileName, const std::vector<char>& data); //on disk when it returns true
+    static bool syncDirectory(const std::filesystem::path& directory);
+
+    struct Job {
+        std::string fileName;
+        std::vector<char> data;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable wake; //new job or shutdown
+    std::condition_variable idle; //worker finished everything
+    std::optional<Job> pending;
+    bool writing{false};
+    bool stopping{false};
+    bool lastWriteOk{true};
+    std::thread worker; //last, so everything above exists before the thread starts
+};
+
+
+
+#endif //CHECKPOINTWRITER_H
@@ -0,0 +1,259 @@
+#include "CmaEs.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Random.h"
+
+namespace {
+    //cyclic jacobi for a symmetric matrix. slow for big n but n is 28 here, and it's only run every few generations.
+    //a is destroyed, eigenvalues end up in values, eigenvectors in the columns of vectors
+    void jacobiEigen(std::vector<double> &a, const size_t n, std::vector<double> &values, std::vector<double> &vectors) {
+        vectors.assign(n * n, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            vectors[i * n + i] = 1.0;
+        }
+        for (int sweep = 0; sweep < 100; ++sweep) {
+            double offDiagonal = 0.0;
+            for (size_t p = 0; p < n; ++p) {
+                for (size_t q = p + 1; q < n; ++q) {
+                    offDiagonal += a[p * n + q] * a[p * n + q];
+                }
+            }
+            if (offDiagonal < 1e-30) {
+                break;
+            }
+            for (size_t p = 0; p < n; ++p) {
+                for (size_t q = p + 1; q < n; ++q) {
+                    const double apq = a[p * n + q];
+                    if (std::abs(apq) < 1e-300) {
+                        continue;
+                    }
+                    //rotation angle that zeroes a[p][q]
+                    const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                    const double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                    const double c = 1.0 / std::sqrt(t * t + 1.0);
+                    const double s = t * c;
+                    for (size_t k = 0; k < n; ++k) {
+                        const double akp = a[k * n + p];
+                        const double akq = a[k * n + q];
+                        a[k * n + p] = c * akp - s * akq;
+                        a[k * n + q] = s * akp + c * akq;
+                    }
+                    for (size_t k = 0; k < n; ++k) {
+                        const double apk = a[p * n + k];
+                        const double aqk = a[q * n + k];
+                        a[p * n + k] = c * apk - s * aqk;
+                        a[q * n + k] = s * apk + c * aqk;
+                    }
+                    for (size_t k = 0; k < n; ++k) {
+                        const double vkp = vectors[k * n + p];
+                        const double vkq = vectors[k * n + q];
+                        vectors[k * n + p] = c * vkp - s * vkq;
+                        vectors[k * n + q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+        values.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = a[i * n + i];
+        }
+    }
+}
+
+CmaEs::CmaEs(const size_t dimension, const size_t lambda, const uint64_t seed, const double initialSigma,
+             const std::vector<double> &initialMean):
+    n(dimension),
+    lambda(std::max<size_t>(lambda, 2)),
+    mu(this->lambda / 2),
+    seed(seed),
+    sigma(initialSigma) {
+    //recombination weights, log decreasing over the best half
+    weights.resize(mu);
+    for (size_t i = 0; i < mu; ++i) {
+        weights[i] = std::log(static_cast<double>(mu) + 0.5) - std::log(static_cast<double>(i) + 1.0);
+    }
+    const double weightSum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double squareSum = 0.0;
+    for (auto &weight : weights) {
+        weight /= weightSum;
+        squareSum += weight * weight;
+    }
+    mueff = 1.0 / squareSum;
+
+    const auto N = static_cast<double>(n);
+    cc = (4.0 + mueff / N) / (N + 4.0 + 2.0 * mueff / N);
+    cs = (mueff + 2.0) / (N + mueff + 5.0);
+    c1 = 2.0 / ((N + 1.3) * (N + 1.3) + mueff);
+    cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((N + 2.0) * (N + 2.0) + mueff));
+    damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (N + 1.0)) - 1.0) + cs;
+    chiN = std::sqrt(N) * (1.0 - 1.0 / (4.0 * N) + 1.0 / (21.0 * N * N));
+
+    mean = initialMean.size() == n ? initialMean : std::vector<double>(n, 0.0);
+    pc.assign(n, 0.0);
+    ps.assign(n, 0.0);
+    C.assign(n * n, 0.0);
+    B.assign(n * n, 0.0);
+    D.assign(n, 1.0);
+    for (size_t i = 0; i < n; ++i) {
+        C[i * n + i] = 1.0;
+        B[i * n + i] = 1.0;
+    }
+}
+
+size_t CmaEs::defaultLambda(const size_t dimension) {
+    return 4 + static_cast<size_t>(3.0 * std::log(static_cast<double>(dimension)));
+}
+
+std::vector<Chromosome> CmaEs::ask() {
+    //x = mean + sigma * B * D * z, z standard normal
+    samples.assign(lambda, std::vector<double>(n));
+    std::vector<Chromosome> candidates(lambda);
+    std::vector<double> scaled(n);
+    for (size_t k = 0; k < lambda; ++k) {
+        RandomStream rng(seed, iteration, k, SAMPLE_STREAM);
+        for (size_t i = 0; i < n; ++i) {
+            scaled[i] = D[i] * rng.nextGaussian();
+        }
+        auto &x = samples[k];
+        candidates[k].genes.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            double y = 0.0;
+            for (size_t j = 0; j < n; ++j) {
+                y += B[i * n + j] * scaled[j];
+            }
+            x[i] = mean[i] + sigma * y;
+            candidates[k].genes[i] = static_cast<float>(x[i]);
+        }
+    }
+    return candidates;
+}
+
+bool CmaEs::tell(const std::vector<Chromosome> &evaluated) {
+    if (samples.empty() || evaluated.size() != samples.size()) {
+        return false; //not the batch we handed out
+    }
+    //rank by fitness, best first
+    std::vector<size_t> order(lambda);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, [&](const size_t a, const size_t b) {return evaluated[a].fitness > evaluated[b].fitness;});
+
+    const std::vector<double> oldMean = mean;
+    std::ranges::fill(mean, 0.0);
+    for (size_t i = 0; i < mu; ++i) {
+        const auto &x = samples[order[i]];
+        for (size_t j = 0; j < n; ++j) {
+            mean[j] += weights[i] * x[j];
+        }
+    }
+    std::vector<double> yw(n);
+    for (size_t j = 0; j < n; ++j) {
+        yw[j] = (mean[j] - oldMean[j]) / sigma;
+    }
+
+    //ps uses C^-1/2 * yw = B * D^-1 * B^T * yw
+    std::vector<double> projected(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            projected[i] += B[j * n + i] * yw[j];
+        }
+        projected[i] /= D[i];
+    }
+    const double csFactor = std::sqrt(cs * (2.0 - cs) * mueff);
+    double psNorm = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double value = 0.0;
+        for (size_t j = 0; j < n; ++j) {
+            value += B[i * n + j] * projected[j];
+        }
+        ps[i] = (1.0 - cs) * ps[i] + csFactor * value;
+        psNorm += ps[i] * ps[i];
+    }
+    psNorm = std::sqrt(psNorm);
+
+    ++iteration;
+    evaluations += lambda;
+    const double expectedNorm = std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * static_cast<double>(iteration)));
+    const bool hsig = psNorm / expectedNorm / chiN < 1.4 + 2.0 / (static_cast<double>(n) + 1.0);
+
+    const double ccFactor = std::sqrt(cc * (2.0 - cc) * mueff);
+    for (size_t i = 0; i < n; ++i) {
+        pc[i] = (1.0 - cc) * pc[i] + (hsig ? ccFactor * yw[i] : 0.0);
+    }
+
+    //rank one from pc, rank mu from the selected steps
+    const double c1a = c1 * (1.0 - (hsig ? 0.0 : cc * (2.0 - cc)));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double rankMu = 0.0;
+            for (size_t k = 0; k < mu; ++k) {
+                const auto &x = samples[order[k]];
+                rankMu += weights[k] * (x[i] - oldMean[i]) * (x[j] - oldMean[j]);
+            }
+            rankMu /= sigma * sigma;
+            const double value = (1.0 - c1a - cmu) * C[i * n + j] + c1 * pc[i] * pc[j] + cmu * rankMu;
+            C[i * n + j] = value;
+            C[j * n + i] = value;
+        }
+    }
+
+    sigma *= std::exp((cs / damps) * (psNorm / chiN - 1.0));
+
+    //the decomposition is O(n^3), refresh it only as often as C meaningfully changes
+    if (static_cast<double>(evaluations - eigenEvaluations) > static_cast<double>(lambda) / (c1 + cmu) / static_cast<double>(n) / 10.0) {
+        updateEigen();
+    }
+    return true;
+}
+
+void CmaEs::updateEigen() {
+    eigenEvaluations = evaluations;
+    std::vector<double> work = C;
+    std::vector<double> values;
+    jacobiEigen(work, n, values, B);
+    for (size_t i = 0; i < n; ++i) {
+        D[i] = std::sqrt(std::max(values[i], 1e-20));
+    }
+}
+
+Chromosome CmaEs::getMean() const {
+    Chromosome chromosome;
+    chromosome.genes.assign(mean.begin(), mean.end());
+    return chromosome;
+}
+
+std::vector<double> CmaEs::getState() const {
+    //counters first, then the vectors in a fixed order. B and D get rebuilt from C on load
+    std::vector<double> state;
+    state.reserve(6 + 3 * n + n * n);
+    state.push_back(static_cast<double>(n));
+    state.push_back(static_cast<double>(lambda));
+    state.push_back(static_cast<double>(iteration));
+    state.push_back(static_cast<double>(evaluations));
+    state.push_back(sigma);
+    state.insert(state.end(), mean.begin(), mean.end());
+    state.insert(state.end(), pc.begin(), pc.end());
+    state.insert(state.end(), ps.begin(), ps.end());
+    state.insert(state.end(), C.begin(), C.end());
+    return state;
+}
+
+bool CmaEs::setState(const std::vector<double> &state) {
+    if (state.size() != 5 + 3 * n + n * n || state[0] != static_cast<double>(n) || state[1] != static_cast<double>(lambda)) {
+        return false;
+    }
+    iteration = static_cast<uint64_t>(state[2]);
+    evaluations = static_cast<uint64_t>(state[3]);
+    sigma = state[4];
+    auto it = state.begin() + 5;
+    mean.assign(it, it + n);
+    it += n;
+    pc.assign(it, it + n);
+    it += n;
+    ps.assign(it, it + n);
+    it += n;
+    C.assign(it, it + n * n);
+    updateEigen();
+    return true;
+}
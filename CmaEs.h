@@ -0,0 +1,68 @@
+#ifndef CMAES_H
+#define CMAES_H
+#include <cstdint>
+#include <vector>
+
+#include "Optimizer.h"
+
+/*
+ * (mu/mu_w, lambda) CMA-ES. learns a full covariance over the genes, so for a 28 weight policy it
+ * needs far fewer rollouts than crossover + mutation to get to the same fitness.
+ * standard default parameters, maximises fitness. samples come from counter based streams keyed on
+ * (seed, iteration, candidate), so a run is reproducible no matter how the candidates get evaluated
+ */
+
+class CmaEs : public Optimizer {
+public:
+    CmaEs(size_t dimension, size_t lambda, uint64_t seed, double initialSigma = 0.5,
+          const std::vector<double>& initialMean = {});
+
+    std::vector<Chromosome> ask() override;
+    bool tell(const std::vector<Chromosome>& evaluated) override;
+    [[nodiscard]] Chromosome getMean() const override;
+
+    [[nodiscard]] std::vector<double> getState() const override;
+    bool setState(const std::vector<double>& state) override;
+
+    [[nodiscard]] double getSigma() const {return sigma;}
+    [[nodiscard]] size_t getLambda() const {return lambda;}
+    [[nodiscard]] static size_t defaultLambda(size_t dimension);
+
+private:
+    void updateEigen();
+
+    size_t n;
+    size_t lambda;
+    size_t mu;
+    uint64_t seed;
+
+    //strategy parameters, fixed once n and lambda are known
+    std::vector<double> weights;
+    double mueff{0};
+    double cc{0};
+    double cs{0};
+    double c1{0};
+    double cmu{0};
+    double damps{0};
+    double chiN{0};
+
+    //dynamic state
+    std::vector<double> mean;
+    double sigma;
+    std::vector<double> pc;
+    std::vector<double> ps;
+    std::vector<double> C; //n x n row major
+    std::vector<double> B; //eigenvectors of C, columns
+    std::vector<double> D; //sqrt of the eigenvalues
+    uint64_t iteration{0};
+    uint64_t evaluations{0};
+    uint64_t eigenEvaluations{0}; //evaluation count when B and D were last refreshed
+
+    std::vector<std::vector<double>> samples; //last ask(), kept in double so tell() doesn't lose precision
+
+    static constexpr uint64_t SAMPLE_STREAM = ~0ull - 2;
+};
+
+
+
+#endif //CMAES_H
@@ -0,0 +1,116 @@
+#include "Curriculum.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Profiler.h"
+
+MazeDifficulty Curriculum::measure(const Maze &maze) {
+    PROFILE_SCOPE("measure difficulty");
+    MazeDifficulty difficulty;
+    const size_t width = maze.width;
+    const size_t height = maze.height;
+    const size_t cellCount = width * height;
+    if (cellCount == 0) {
+        return difficulty;
+    }
+
+    //ways out of a cell, border walls count as walls even if a file has them knocked out
+    const auto openings = [&](const size_t cell, int32_t* neighbors) {
+        const size_t x = cell % width;
+        const size_t y = cell / width;
+        const uint8_t walls = maze.cells[cell];
+        int count = 0;
+        if (y > 0 && !(walls & WALL_N)) {
+            neighbors[count++] = static_cast<int32_t>(cell - width);
+        }
+        if (x + 1 < width && !(walls & WALL_E)) {
+            neighbors[count++] = static_cast<int32_t>(cell + 1);
+        }
+        if (y + 1 < height && !(walls & WALL_S)) {
+            neighbors[count++] = static_cast<int32_t>(cell + width);
+        }
+        if (x > 0 && !(walls & WALL_W)) {
+            neighbors[count++] = static_cast<int32_t>(cell - 1);
+        }
+        return count;
+    };
+
+    //bfs from the start, parents double as the visited set. dead ends get counted on the way past
+    std::vector<int32_t> parents(cellCount, -1);
+    std::vector<int32_t> queue;
+    queue.reserve(cellCount);
+    queue.push_back(0);
+    parents[0] = 0;
+    int32_t neighbors[4];
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int32_t cell = queue[head];
+        const int count = openings(cell, neighbors);
+        difficulty.deadEnds += count == 1;
+        for (int i = 0; i < count; ++i) {
+            if (parents[neighbors[i]] < 0) {
+                parents[neighbors[i]] = cell;
+                queue.push_back(neighbors[i]);
+            }
+        }
+    }
+
+    const auto goal = static_cast<int32_t>(cellCount - 1);
+    if (parents[goal] < 0) {
+        //can't be solved, put it after everything that can
+        difficulty.score = std::numeric_limits<float>::infinity();
+        return difficulty;
+    }
+    //walk back along the path, every opening that isn't the way in or out is a branch the agent could take
+    uint32_t sideOpenings = 0;
+    int32_t cell = goal;
+    while (true) {
+        ++difficulty.pathLength;
+        const int onPath = (cell != goal) + (cell != 0);
+        sideOpenings += std::max(0, openings(cell, neighbors) - onPath);
+        if (cell == 0) {
+            break;
+        }
+        cell = parents[cell];
+    }
+    difficulty.branching = static_cast<float>(sideOpenings) / static_cast<float>(difficulty.pathLength);
+    difficulty.score = static_cast<float>(difficulty.pathLength) * (1.0f + difficulty.branching);
+    return difficulty;
+}
+
+void Curriculum::setSchedule(const bool enabled, const float startFraction, const float rampFraction) {
+    this->enabled = enabled;
+    this->startFraction = std::clamp(startFraction, 0.0f, 1.0f);
+    this->rampFraction = std::clamp(rampFraction, 0.0f, 1.0f);
+}
+
+void Curriculum::setDifficulties(const std::vector<MazeDifficulty> &difficulties) {
+    order.resize(difficulties.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    //stable so equally hard mazes stay in file order and the same folder always gives the same schedule
+    std::ranges::stable_sort(order, [&](const uint32_t a, const uint32_t b) {
+        if (difficulties[a].score != difficulties[b].score) {
+            return difficulties[a].score < difficulties[b].score;
+        }
+        return difficulties[a].deadEnds < difficulties[b].deadEnds;
+    });
+}
+
+void Curriculum::select(const size_t generation, const size_t generationCount, std::vector<uint32_t> &active) const {
+    size_t count = order.size();
+    if (enabled && !order.empty()) {
+        const float rampGenerations = rampFraction * static_cast<float>(generationCount);
+        float progress = rampGenerations > 0.0f
+                             ? std::min(1.0f, static_cast<float>(generation) / rampGenerations)
+                             : 1.0f;
+        //in a few steps rather than a maze at a time, every step up means rescoring whatever carried over
+        progress = std::floor(progress * STAGES) / STAGES;
+        const float fraction = startFraction + (1.0f - startFraction) * progress;
+        count = std::clamp<size_t>(static_cast<size_t>(std::ceil(fraction * static_cast<float>(order.size()))), 1,
+                                   order.size());
+    }
+    active.assign(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(count));
+    std::ranges::sort(active);
+}
@@ -0,0 +1,53 @@
+#ifndef CURRICULUM_H
+#define CURRICULUM_H
+#include <cstdint>
+#include <vector>
+
+#include "Maze.h"
+
+/*
+ * orders the training mazes easy to hard and hands training a growing prefix of them.
+ * early generations only see the short, straightforward mazes, which are cheap to roll out and where a half decent
+ * policy actually reaches the goal, so there's some signal to select on. the hard ones come in as training goes.
+ * difficulty is measured once per maze (one bfs from start to goal), not per generation
+ */
+
+//how hard a maze is for a rollout from the top left to the bottom right
+struct MazeDifficulty {
+    uint32_t pathLength{0}; //cells on the shortest path, 0 if the goal can't be reached
+    uint32_t deadEnds{0}; //cells with only one way out
+    float branching{0.0f}; //side openings per cell along the shortest path, i.e. wrong turns on offer
+    float score{0.0f}; //what the mazes get ordered by, pathLength * (1 + branching)
+};
+
+class Curriculum {
+public:
+    static MazeDifficulty measure(const Maze& maze);
+
+    //startFraction of the mazes (easiest first) at generation 0, growing linearly to all of them
+    //rampFraction of the way through the run. disabled, every generation gets every maze
+    void setSchedule(bool enabled, float startFraction = 0.25f, float rampFraction = 0.5f);
+    [[nodiscard]] bool isEnabled() const {return enabled;}
+
+    void setDifficulties(const std::vector<MazeDifficulty>& difficulties);
+    //indices of the mazes to train on this generation, in maze order so rollouts walk memory forwards.
+    //with everything active it's just 0..n-1 and fitnesses come out exactly as without a curriculum
+    void select(size_t generation, size_t generationCount, std::vector<uint32_t>& active) const;
+
+private:
+    bool enabled{false};
+    float startFraction{0.25f};
+    float rampFraction{0.5f};
+    std::vector<uint32_t> order; //maze indices, easiest first
+
+    static constexpr float STAGES = 8.0f; //how many times the set grows before it's everything
+
+    static constexpr uint8_t WALL_N = 1 << 0;
+    static constexpr uint8_t WALL_S = 1 << 1;
+    static constexpr uint8_t WALL_E = 1 << 2;
+    static constexpr uint8_t WALL_W = 1 << 3;
+};
+
+
+
+#endif //CURRICULUM_H
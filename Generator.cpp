@@ -1,72 +1,161 @@
 #include <iostream>
 #include "Generator.h"
+#include "MazeIO.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 #include <algorithm>
 #include <array>
-#include <fstream>
 
 
-Generator::Generator(const int width, const int height) : rng(std::random_device{}()) {
-    //init the maze with the given width and height
-    maze.width = width;
-    maze.height = height;
-
-    //set all walls to full
-    maze.cells.resize(width * height);
-    maze.visited.resize(width * height, false);
+Generator::Generator(const int width, const int height, const uint64_t seed) : seed(seed), rng(seed) {
+    //init the maze with the given width and height, reset() puts all the walls up
+    maze = MazeHandle(Maze{static_cast<size_t>(width), static_cast<size_t>(height), {}});
     reset();
 }
 
 void Generator::generateMaze() {
+    PROFILE_SCOPE("generate maze");
+    PROFILE_COUNT(MazesGenerated, 1);
     reset();
+    //restart the stream so the same seed always carves the same maze
+    rng = RandomStream(seed);
 
 
     //start in the top left always, goal is bottom right.
-    const Movement startingMovement = {0, 0, DOWN};
-    updateStep(startingMovement);
+    //reset() already gave us a maze nobody else holds, so this doesn't copy
+    Maze& carving = maze.edit();
+    carve(carving, rng, {0, 0, carving.width, carving.height}, visited, replay.get());
+}
 
+void Generator::generateMazeTiled(const size_t tileSize, ThreadPool *pool) {
+    PROFILE_SCOPE("generate maze tiled");
+    PROFILE_COUNT(MazesGenerated, 1);
+    reset();
+    Maze& carving = maze.edit();
+    const size_t tile = std::max<size_t>(tileSize, 1);
+    const size_t tilesX = (carving.width + tile - 1) / tile;
+    const size_t tilesY = (carving.height + tile - 1) / tile;
+    const size_t tileCount = tilesX * tilesY;
+    const auto tileRegion = [&](const size_t t) {
+        const size_t x0 = t % tilesX * tile;
+        const size_t y0 = t / tilesX * tile;
+        return Region{x0, y0, std::min(carving.width, x0 + tile), std::min(carving.height, y0 + tile)};
+    };
 
+    //every tile is its own little maze on its own stream, so the result is the same however many threads there
+    //are. tiles only ever touch their own cells, so they can all write into the one maze at once
+    auto carveTile = [&](const size_t t) {
+        PROFILE_SCOPE("carve tile");
+        RandomStream tileRng(seed, 0, t, TILE_STREAM);
+        std::vector<uint8_t> tileVisited;
+        carve(carving, tileRng, tileRegion(t), tileVisited, nullptr);
+    };
+    if (pool) {
+        pool->parallelFor(tileCount, carveTile);
+    }
+    else {
+        for (size_t t = 0; t < tileCount; ++t) {
+            carveTile(t);
+        }
+    }
 
+    //each tile is a tree on its own, so a random spanning tree over the tile grid with one door per edge
+    //joins them into one perfect maze without making any loops
+    PROFILE_SCOPE("join tiles");
+    RandomStream joinRng(seed, 0, tileCount, TILE_STREAM);
+    std::vector<uint8_t> joined(tileCount, 0);
+    std::vector<size_t> stack = {0};
+    joined[0] = 1;
+    while (!stack.empty()) {
+        const size_t t = stack.back();
+        const int tileX = static_cast<int>(t % tilesX);
+        const int tileY = static_cast<int>(t / tilesX);
+        std::array<int, 4> options{};
+        uint32_t optionCount = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            const int neighborX = tileX + dx[direction];
+            const int neighborY = tileY + dy[direction];
+            if (neighborX < 0 || neighborX >= static_cast<int>(tilesX) || neighborY < 0 ||
+                neighborY >= static_cast<int>(tilesY) || joined[neighborY * tilesX + neighborX]) {
+                continue;
+            }
+            options[optionCount++] = direction;
+        }
+        if (optionCount == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const int direction = options[joinRng() % optionCount];
+        //the door goes at a random spot along the shared edge, on this tile's side of it
+        const Region region = tileRegion(t);
+        size_t x = 0;
+        size_t y = 0;
+        if (direction == UP || direction == DOWN) {
+            x = region.x0 + joinRng() % (region.x1 - region.x0);
+            y = direction == UP ? region.y0 : region.y1 - 1;
+        }
+        else {
+            y = region.y0 + joinRng() % (region.y1 - region.y0);
+            x = direction == LEFT ? region.x0 : region.x1 - 1;
+        }
+        removeWall(carving, static_cast<int>(x), static_cast<int>(y), direction);
+        const size_t next = (tileY + dy[direction]) * tilesX + (tileX + dx[direction]);
+        joined[next] = 1;
+        stack.push_back(next);
+    }
 }
 
-void Generator::updateStep(const Movement movement) {
-    //handle the recursion and updating of the cell and neighbor
-    //find current cell with standard formula
-    const int cellNum = movement.y * maze.width + movement.x;
-    //check if the cell is already visited
-    if (maze.visited[cellNum]) {
-        return;
-    }
-    //mark the cell as visited
-    maze.visited[cellNum] = true;
-    //add the cell to the movements vector, including direction
-
-    //recording too many movements, remove this
-    //movements.push_back(movement);
-
-    //find all unvisited neighbors, shuffle array first
-    std::array<int, 4> directions = {UP, RIGHT, DOWN, LEFT};
-    std::ranges::shuffle(directions, rng);
-    for (int i: directions) {
-        //find the neighbor cell
-        const int neighborX = movement.x + dx[i];
-        const int neighborY = movement.y + dy[i];
-        //check if the neighbor is out of bounds
-        if (neighborX < 0 || neighborX >= maze.width || neighborY < 0 || neighborY >= maze.height) {
+void Generator::carve(Maze &maze, RandomStream &rng, const Region region, std::vector<uint8_t> &visited,
+                      Replay *replay) {
+    //depth first from the region's top left corner. explicit stack rather than recursion, a 10^8 cell maze would
+    //go far past the call stack. a frame is the cell, its shuffled directions (2 bits each) and how many of them
+    //have been tried, packed into 64 bits. shuffles happen in the same order the recursive version did them, so
+    //a seed still carves exactly the same maze (and replay)
+    const size_t regionWidth = region.x1 - region.x0;
+    visited.assign(regionWidth * (region.y1 - region.y0), 0);
+    std::vector<uint64_t> stack;
+    const auto enter = [&](const size_t x, const size_t y) {
+        visited[(y - region.y0) * regionWidth + (x - region.x0)] = 1;
+        //find all unvisited neighbors in a random order, shuffle array first
+        std::array<int, 4> directions = {UP, RIGHT, DOWN, LEFT};
+        std::ranges::shuffle(directions, rng);
+        uint64_t order = 0;
+        for (int i = 0; i < 4; ++i) {
+            order |= static_cast<uint64_t>(directions[i]) << (2 * i);
+        }
+        stack.push_back(static_cast<uint64_t>(y * maze.width + x) << FRAME_CELL_SHIFT | order);
+    };
+    enter(region.x0, region.y0);
+
+    while (!stack.empty()) {
+        uint64_t& frame = stack.back();
+        const uint64_t tried = frame >> FRAME_TRIED_SHIFT & 7;
+        if (tried == 4) {
+            stack.pop_back(); //back up, the recursive version returning
+            continue;
+        }
+        frame += uint64_t{1} << FRAME_TRIED_SHIFT;
+        const int direction = static_cast<int>(frame >> (2 * tried) & 3);
+        const size_t cell = frame >> FRAME_CELL_SHIFT;
+        const size_t x = cell % maze.width;
+        const size_t y = cell / maze.width;
+        //check if the neighbor is outside the region
+        if ((direction == UP && y == region.y0) || (direction == DOWN && y + 1 == region.y1) ||
+            (direction == LEFT && x == region.x0) || (direction == RIGHT && x + 1 == region.x1)) {
             continue;
         }
-        const int neighborCellNum = neighborY * maze.width + neighborX;
+        const size_t neighborX = x + dx[direction];
+        const size_t neighborY = y + dy[direction];
         //check if the neighbor is visited
-        if (maze.visited[neighborCellNum]) {
+        if (visited[(neighborY - region.y0) * regionWidth + (neighborX - region.x0)]) {
             continue;
         }
-        //remove the wall between the current cell and the neighbor
-        removeWall(this->maze, movement.x, movement.y, i);
-        //only add remove wall movements to the list
-        movements.push_back({movement.x, movement.y, static_cast<Direction>(i)});
-        //update the step for the neighbor
-        Movement neighborMovement = {neighborX, neighborY, static_cast<Direction>(i)};
-        //recursively update the neighbor
-        updateStep(neighborMovement);
+        //remove the wall between the current cell and the neighbor, only these moves go in the replay
+        removeWall(maze, static_cast<int>(x), static_cast<int>(y), direction);
+        if (replay) {
+            replay->moveFrom(static_cast<int>(cell), static_cast<uint8_t>(direction));
+        }
+        enter(neighborX, neighborY); //frame isn't used after this, the push can move it
     }
 }
 
@@ -119,9 +208,27 @@ void Generator::removeWall(Maze &maze, const int x, const int y, const int direc
     maze.cells[cellNum] = maze.cells[cellNum] & ~wall;
 }
 
+void Generator::addWall(Maze &maze, const int x, const int y, const int direction) {
+    if (direction < UP || direction > LEFT) {
+        return;
+    }
+    //same masks as removeWall, {this cell's side, the neighbour's side}
+    static constexpr uint8_t walls[4][2] = {{WALL_N, WALL_S}, {WALL_E, WALL_W}, {WALL_S, WALL_N}, {WALL_W, WALL_E}};
+    const int width = static_cast<int>(maze.width);
+    const int height = static_cast<int>(maze.height);
+    const int neighborX = x + dx[direction];
+    const int neighborY = y + dy[direction];
+    if (neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height) {
+        return;
+    }
+    maze.cells[y * width + x] |= walls[direction][0];
+    maze.cells[neighborY * width + neighborX] |= walls[direction][1];
+}
+
 
 
 void Generator::printMaze() const {
+    const Maze& maze = *this->maze;
     //print the maze to the console, in a square format
     //print top border first
     std::cout << " ";
@@ -142,48 +249,33 @@ void Generator::printMaze() const {
 }
 
 void Generator::reset() {
-    for (int i = 0; i < maze.width * maze.height; ++i) {
-        maze.cells[i] = WALL_N | WALL_S | WALL_E | WALL_W;
-        maze.visited[i] = false;
+    const size_t width = maze->width;
+    const size_t height = maze->height;
+    //every cell gets overwritten, so if the old maze is still out there (solver, animation) start a new one
+    //rather than copying it just to throw the copy away
+    Maze& fresh = maze.rewrite();
+    fresh.width = width;
+    fresh.height = height;
+    fresh.cells.assign(width * height, WALL_N | WALL_S | WALL_E | WALL_W);
+    //the simulation might still be playing the old one, only reuse it if nobody else holds it
+    if (replay.use_count() == 1) {
+        replay->clear(width);
+    }
+    else {
+        replay = std::make_shared<Replay>(width);
     }
-    movements.clear();
 }
 
 
 bool Generator::saveMazeToFile(const std::string &fileName) const {
-    std::ofstream file{fileName, std::ios::binary};
-    const auto width = maze.width;
-    const auto height = maze.height;
-    if (!file) {
-        std::cerr << "Error opening file for writing: " << fileName << std::endl;
-        return false;
-    }
-    //write the maze to the file in binary, not human readable
-    file.write(reinterpret_cast<const char*>(&width), sizeof(width));
-    file.write(reinterpret_cast<const char*>(&height), sizeof(height));
-    file.write(reinterpret_cast<const char*>(maze.cells.data()), maze.cells.size() * sizeof(uint8_t));
-
-    return true;
-
+    return MazeIO::writeFile(fileName, *maze);
 }
 
 bool Generator::loadMazeFromFile(const std::string &fileName) {
-    std::ifstream file{fileName, std::ios::binary};
-    if (!file) {
-        std::cerr << "Error opening file for reading: " << fileName << std::endl;
+    Maze loaded;
+    if (!MazeIO::readFile(fileName, loaded)) {
         return false;
     }
-    //read the maze from the file in binary
-    size_t width = 0;
-    size_t height = 0;
-    file.read(reinterpret_cast<char*>(&width), sizeof(width));
-    file.read(reinterpret_cast<char*>(&height), sizeof(height));
-    maze.cells.resize(width * height);
-    maze.width = width;
-    maze.height = height;
-    file.read(reinterpret_cast<char*>(maze.cells.data()), maze.cells.size() * sizeof(uint8_t));
-    //add maze data to cells
-
-
+    setMaze(MazeHandle(std::move(loaded)));
     return true;
 }
\ No newline at end of file
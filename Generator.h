@@ -1,8 +1,14 @@
 
 #ifndef GENERATOR_H
 #define GENERATOR_H
+#include <memory>
 #include <random>
 #include <vector>
+#include "Maze.h"
+#include "Random.h"
+#include "Replay.h"
+
+class ThreadPool;
 
 //This code handles generating the maze, using depth first or whatever else I decide later
 // Create an enum of movement commands, good for GA. Corresponds with the arrays above
@@ -13,12 +19,6 @@ enum Direction {
     LEFT = 3
 };
 
-struct Maze {
-    size_t width, height;
-    std::vector<uint8_t> cells;
-    std::vector<bool> visited;
-};
-
 struct Movement {
     int x, y;
     Direction direction;
@@ -26,21 +26,26 @@ struct Movement {
 
 class Generator {
 public:
-    Generator(int width, int height);
+    Generator(int width, int height, uint64_t seed = std::random_device{}());
     ~Generator() = default;
 
     void generateMaze();
-    void updateStep(Movement movement);
+    //for really big single mazes: tileSize x tileSize tiles are carved independently (on the pool if there is
+    //one) and then joined by a random spanning tree over the tiles, one door per tile edge. still a perfect maze
+    //and the same one for a given seed whatever the thread count, but nothing goes in the replay
+    void generateMazeTiled(size_t tileSize, ThreadPool* pool = nullptr);
     static void removeWall(Maze& maze, int x, int y, int direction);
-
-    void setMaze(const Maze& maze){this->maze = maze;}
-    [[nodiscard]] const Maze& getMaze() const{return maze;}
-    Maze& getMaze() {return maze;}
-    [[nodiscard]] const std::vector<Movement>& getMovements() const{return movements;}
-    const void setWidth(const int width){this->maze.width = width;}
-    const void setHeight(int height){this->maze.height = height;}
-    [[nodiscard]] int getWidth() const{return maze.width;}
-    [[nodiscard]] int getHeight() const{return maze.height;}
+    //puts both halves of the wall back, the opposite of removeWall. border walls are always there already
+    static void addWall(Maze& maze, int x, int y, int direction);
+
+    void setMaze(MazeHandle maze) {this->maze = std::move(maze);}
+    [[nodiscard]] const Maze& getMaze() const{return *maze;}
+    //the same maze, shared. a later generate makes a new version, whoever holds this one keeps it as it is
+    [[nodiscard]] const MazeHandle& getHandle() const{return maze;}
+    //every wall knocked down, in order. shared so an animation can keep playing it after the next generate
+    [[nodiscard]] std::shared_ptr<const Replay> getReplay() const{return replay;}
+    [[nodiscard]] int getWidth() const{return maze->width;}
+    [[nodiscard]] int getHeight() const{return maze->height;}
 
     bool saveMazeToFile(const std::string& fileName) const;
     bool loadMazeFromFile(const std::string& fileName);
@@ -48,11 +53,15 @@ public:
     void printMaze() const; //probably useless but leaving it here for testing
 
     void reset();
+    void setSeed(uint64_t seed) {this->seed = seed; rng = RandomStream(seed);}
+    [[nodiscard]] uint64_t getSeed() const {return seed;}
 
 private:
-    std::mt19937 rng;
-    Maze maze;
-    std::vector<Movement> movements; //steps to generate the maze, useful for rendering but not necessary
+    uint64_t seed;
+    RandomStream rng;
+    MazeHandle maze;
+    std::vector<uint8_t> visited; //carving scratch, kept so regenerating doesn't reallocate it
+    std::shared_ptr<Replay> replay = std::make_shared<Replay>(); //steps to generate the maze, useful for rendering but not necessary
 
 
     //add mask for walls here.
@@ -61,6 +70,15 @@ private:
     static constexpr uint8_t WALL_E = 1 << 2;
     static constexpr uint8_t WALL_W = 1 << 3;
 
+    struct Region {
+        size_t x0, y0, x1, y1; //cells [x0, x1) x [y0, y1)
+    };
+    static void carve(Maze& maze, RandomStream& rng, Region region, std::vector<uint8_t>& visited, Replay* replay);
+
+    static constexpr int FRAME_TRIED_SHIFT = 8; //carve stack frames: cell << 11 | tried << 8 | 4 x 2 bit directions
+    static constexpr int FRAME_CELL_SHIFT = 11;
+    static constexpr uint64_t TILE_STREAM = ~0ull; //maze id of the tile streams, the plain generator uses 0
+
     // direction arrays
     //   0 = Up    (north)
     //   1 = Right (east)
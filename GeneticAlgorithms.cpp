@@ -1,199 +1,399 @@
 
 #include "GeneticAlgorithms.h"
+#include "CmaEs.h"
+#include "MazeHash.h"
+#include "MazePrefetcher.h"
+#include "NoveltyArchive.h"
+#include "Profiler.h"
 #include <fstream>
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include <filesystem>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
 
-GeneticAlgorithms::GeneticAlgorithms(const size_t populationSize, const size_t generationCount, const float crossoverRate, const float mutationRate):
+GeneticAlgorithms::GeneticAlgorithms(const size_t populationSize, const size_t generationCount, const float crossoverRate, const float mutationRate,
+                                     const uint64_t seed):
     populationSize(populationSize),
     generationCount(generationCount),
     crossoverRate(crossoverRate),
     mutationRate(mutationRate),
-    rng(std::random_device{}()) {
+    seed(seed) {
+    setThreadCount(std::thread::hardware_concurrency());
     initPopulation(populationSize);
     //MAX_STEPS_PER_MAZE = 100;
 }
 
+GeneticAlgorithms::~GeneticAlgorithms() = default;
+
 
 void GeneticAlgorithms::loadMazes(const std::string& folderPath) {
+    loadMazes(MazePrefetcher::listFolder(folderPath));
+    std::cout << "Loaded " << mazes.size() << " mazes from " << folderPath << std::endl;
+}
+
+void GeneticAlgorithms::loadMazes(const std::vector<std::string> &fileNames) {
+    PROFILE_SCOPE("load mazes");
     mazes.clear();
-    for (const auto& entry : std::filesystem::directory_iterator(folderPath)) {
-        if (!entry.is_regular_file()) continue;
-        std::ifstream file(entry.path());
-        if (!file) {
-            std::cerr << "Failed to open maze file: " << entry.path() << std::endl;
-            continue;
-        }
-        Maze maze;
-        size_t width = 0;
-        size_t height = 0;
-        file.read(reinterpret_cast<char*>(&width), sizeof(width));
-        file.read(reinterpret_cast<char*>(&height), sizeof(height));
-        maze.cells.resize(width * height);
-        maze.width = width;
-        maze.height = height;
-        file.read(reinterpret_cast<char*>(maze.cells.data()), maze.cells.size() * sizeof(uint8_t));
-        //add maze data to cells
-        mazes.push_back(std::move(maze));
+    //reads run a couple of batches ahead, so decoding one batch overlaps with the disk fetching the next
+    AsyncIO io;
+    MazePrefetcher prefetcher(io, fileNames, LOAD_BATCH_SIZE);
+    std::vector<Maze> batch;
+    while (prefetcher.next(batch)) {
+        std::ranges::move(batch, std::back_inserter(mazes));
     }
-    std::cout << "Loaded " << mazes.size() << " mazes from " << folderPath << std::endl;
+    //a copy of a maze is just the same rollouts scored twice. exact copies only, the genes weight N/E/S/W
+    //separately so a mirrored maze is a different task for the policy
+    if (const size_t duplicates = MazeHash::removeDuplicates(mazes); duplicates > 0) {
+        std::cout << "Skipped " << duplicates << " duplicate mazes, " << mazes.size() << " unique" << std::endl;
+    }
+    prepareMazes();
     //set max steps to be able to visit all cells of maze
     //MAX_STEPS_PER_MAZE = mazes[0].width * mazes[0].height * 2;
 
 }
 
+void GeneticAlgorithms::setMazes(std::vector<Maze> mazes) {
+    this->mazes = std::move(mazes);
+    prepareMazes();
+}
 
-float GeneticAlgorithms::evaluate(const Maze &maze, const Chromosome &chromosome) const {
+float GeneticAlgorithms::evaluate(const Maze &maze, const Chromosome &chromosome, RandomStream &rng) const {
     // evaluate the chromosome's performance on the maze
-    // this should return a score based on the maze and the chromosome's genes
-
-    int currentCell = 0; //start at the top left
-    const int goalCell = maze.cells.size() - 1; //goal is bottom right
-    bool reachedGoal = false;
-    std::vector<bool> visited(maze.cells.size(), false);
-    visited[currentCell] = true;
-    int numRepeats = 0; //reset repeat visits
-    //populate this with visited or not to penalize repeat visits to cells
-    int steps = 0;
-    int wallCollisions = 0;
-    static constexpr int wallMasks[4] = {
-        WALL_N,
-        WALL_E,
-        WALL_S,
-        WALL_W
-    };
+    // one off version, training goes through evaluateBatch with the mazes already prepared
+    const PreparedMaze prepared = RolloutKernel::prepare(maze);
+    const CompiledPolicy policy = RolloutKernel::compile(chromosome.genes.data());
+    return scoreRollout(prepared, RolloutKernel::run(prepared, policy, rng, MAX_STEPS_PER_MAZE));
+}
+
+float GeneticAlgorithms::scoreRollout(const PreparedMaze &maze, const RolloutState &rollout) {
+    //calculate fitness score
+    float fitness = 0.0f;
+    fitness += -STEP_PENALTY * rollout.steps;
+    fitness += -DISTANCE_BONUS * (std::abs(rollout.x - maze.goalX) + std::abs(rollout.y - maze.goalY));
+    fitness += -HIT_PENALTY * rollout.wallCollisions; //penalty for hitting a wall
+    fitness += -HIT_PENALTY * rollout.repeats; //penalty for revisiting a cell
+
+    if (rollout.reachedGoal) {
+        fitness += GOAL_BONUS; //bonus for reaching the goal
+    }
+    fitness += STEP_PENALTY * MAX_STEPS_PER_MAZE;
+    return fitness;
+}
+
+void GeneticAlgorithms::describeRollout(const PreparedMaze &maze, const RolloutState &rollout, const RolloutTrace &trace,
+                                        float *behaviour) {
+    //everything in [0, 1], so mazes of different sizes weigh the same in the average
+    behaviour[0] = maze.width > 1 ? static_cast<float>(rollout.x) / static_cast<float>(maze.width - 1) : 0.0f;
+    behaviour[1] = maze.height > 1 ? static_cast<float>(rollout.y) / static_cast<float>(maze.height - 1) : 0.0f;
+    const auto steps = static_cast<float>(std::max(rollout.steps, 1));
+    for (size_t region = 0; region < trace.visits.size(); ++region) {
+        behaviour[2 + region] = static_cast<float>(trace.visits[region]) / steps;
+    }
+}
 
-    while (steps < MAX_STEPS_PER_MAZE && !reachedGoal) {
-        //calculate heuristic
-        const int heuristic = calculateHeuristic(maze, currentCell, goalCell);
+void GeneticAlgorithms::initPopulation(const size_t populationSize) {
+    population.clear();
+    this->populationSize = populationSize;
+    population.resize(populationSize);
+    for (size_t i = 0; i < populationSize; ++i) {
+        auto &chromosome = population[i];
+        RandomStream rng(seed, 0, i, INIT_STREAM);
+        chromosome.genes.resize(numGenes); // Assuming 20 genes for now
+        for (auto &gene : chromosome.genes) {
+            gene = rng.nextFloat() * 2.0f - 1.0f; // Random values between -1 and 1
+        }
+        chromosome.fitness = 0.0f; // Initialize fitness to 0
+    }
+    std::cout << population.size() << " chromosomes generated" << std::endl;
 
-        //read wall flags and feed into scoring array
 
-        std::array<float, numInputs> features{};
+}
+
+void GeneticAlgorithms::prepareMazes() {
+    //per maze constants for the rollout kernel, these point into mazes so redo them whenever it changes
+    preparedMazes.clear();
+    preparedMazes.reserve(mazes.size());
+    for (const auto &maze : mazes) {
+        preparedMazes.push_back(RolloutKernel::prepare(maze));
+    }
+    //one bfs per maze, cheap next to a single generation but still worth spreading over the pool
+    difficulties.assign(mazes.size(), MazeDifficulty{});
+    auto measureOne = [&](const size_t m) {difficulties[m] = Curriculum::measure(mazes[m]);};
+    if (pool) {
+        pool->parallelFor(mazes.size(), measureOne);
+    }
+    else {
+        for (size_t m = 0; m < mazes.size(); ++m) {
+            measureOne(m);
+        }
+    }
+    curriculum.setDifficulties(difficulties);
+    curriculum.select(generation, generationCount, activeMazes);
+}
 
+bool GeneticAlgorithms::selectMazes() {
+    const size_t previous = activeMazes.size();
+    curriculum.select(generation, generationCount, activeMazes);
+    return activeMazes.size() != previous;
+}
 
-        const auto walls = maze.cells[currentCell];
+void GeneticAlgorithms::rescoreCarriedOver() {
+    //fitnesses that survive between generations were scored on the old, easier set. left alone they'd beat
+    //anything scored on the new one, so score them again
+    if (archive) {
+        //with novelty on every mode keeps the best across generations (see keepBestObjective), so it's stale too.
+        //the next scoring picks a new one off the new set
+        bestChromosome = Chromosome{};
+    }
+    if (evolutionMode == EvolutionMode::SteadyState || evolutionMode == EvolutionMode::MuPlusLambda) {
+        //the whole population, on the same stream ids (0..population) a fresh score of it would get. the children
+        //bred this generation start past populationSize so they don't share them
+        evaluateBatch(population, generation, 0);
+        sortElites(eliteCount);
+    }
+    else if (evolutionMode == EvolutionMode::CmaEs && !bestChromosome.genes.empty()) {
+        //just the kept best, on the stream id past this generation's samples, which use 0..population
+        std::vector<Chromosome> best = {bestChromosome};
+        evaluateBatch(best, generation, populationSize);
+        bestChromosome = std::move(best.front());
+    }
+}
 
+void GeneticAlgorithms::evaluateChromosomes() {
+    evaluateBatch(population, generation, 0);
+}
 
-        for (int direction = 0; direction < 4; ++direction) {
-            if (walls & wallMasks[direction]) {
-                features[direction] = 1.0f; //wall present
+void GeneticAlgorithms::evaluateBatch(std::vector<Chromosome> &batch, const uint64_t streamGeneration,
+                                      const size_t streamOffset) {
+    //this is the one place rollouts happen, every evolution mode goes through here
+    PROFILE_SCOPE("evaluate batch");
+    std::vector<CompiledPolicy> policies(batch.size());
+    for (size_t c = 0; c < batch.size(); ++c) {
+        policies[c] = RolloutKernel::compile(batch[c].genes.data());
+    }
+    //a maze at a time, so chromosomes that would walk it exactly the same way can share one rollout.
+    //fitnesses go into a [chromosome][maze] grid and get summed per chromosome at the end, in maze order,
+    //so every total is the same float it was when they were added up as they came in
+    const size_t mazeCount = activeMazes.size();
+    std::vector<float> fitnesses(batch.size() * mazeCount);
+    //same grid for behaviours, BEHAVIOUR_SIZE floats a rollout, only when novelty search wants them
+    std::vector<float> behaviours(archive ? batch.size() * mazeCount * BEHAVIOUR_SIZE : 0);
+    const auto behaviourOf = [&](const size_t c, const size_t k) {
+        return behaviours.data() + (c * mazeCount + k) * BEHAVIOUR_SIZE;
+    };
+    auto evaluateMaze = [&](const size_t k) {
+        PROFILE_SCOPE("evaluate maze");
+        const uint32_t m = activeMazes[k];
+        const auto &maze = preparedMazes[m];
+        auto rollOut = [&](const size_t c, const uint8_t* table) {
+            //each rollout gets its own stream so the order (or thread) they run in doesn't matter
+            RandomStream rng(seed, streamGeneration, streamOffset + c, m);
+            RolloutTrace trace;
+            RolloutTrace* traced = archive ? &trace : nullptr;
+            const RolloutState rollout =
+                table ? RolloutKernel::runTable(maze, table, policies[c], rng, MAX_STEPS_PER_MAZE, traced)
+                      : RolloutKernel::run(maze, policies[c], rng, MAX_STEPS_PER_MAZE, traced);
+            fitnesses[c * mazeCount + k] = scoreRollout(maze, rollout);
+            if (traced) {
+                describeRollout(maze, rollout, trace, behaviourOf(c, k));
             }
-            else {
-                features[direction] = 0.0f; //no wall
+            PROFILE_COUNT(Rollouts, 1);
+            PROFILE_COUNT(RolloutSteps, rollout.steps);
+            PROFILE_COUNT(WallHits, rollout.wallCollisions);
+            PROFILE_COUNT(RepeatVisits, rollout.repeats);
+        };
+        if (maze.maze->cells.size() > ACTION_TABLE_MAX_CELLS) {
+            //a rollout only sees a few of a big maze's cells, scoring them as it goes beats tabling them all
+            for (size_t c = 0; c < batch.size(); ++c) {
+                rollOut(c, nullptr);
             }
+            return;
         }
-        int goalX = goalCell % maze.width;
-        int goalY = goalCell / maze.width;
-        int currentX = currentCell % maze.width;
-        int currentY = currentCell / maze.width;
-
-        features[4] = (goalX - currentX)/ float(maze.width); //normalize heuristic
-        features[5] = (goalY - currentY)/ float(maze.height); //normalize heuristic
-        features[6] = 1.0f; //bias term, leave at 1 to keep bias the same
-
-        // create output array to hold the scores for each direction
-        std::array<float, numOutputs> outputs{};
-        // calculate the scores for each direction
-        for (int i = 0; i < numOutputs; ++i) {
-            outputs[i] = 0.0f;
-            for (int j = 0; j < numInputs; ++j) {
-                outputs[i] += chromosome.genes[i * numInputs + j] * features[j];
+        const size_t tableSize = RolloutKernel::tableSize(maze);
+        thread_local std::vector<uint8_t> tables;
+        thread_local std::unordered_map<uint64_t, size_t> firstWithTable;
+        tables.resize(batch.size() * tableSize);
+        firstWithTable.clear();
+        for (size_t c = 0; c < batch.size(); ++c) {
+            uint8_t* table = tables.data() + c * tableSize;
+            //coin flips come off each chromosome's own stream, so only tables without ties are the same rollout
+            if (!RolloutKernel::buildTable(maze, policies[c], table)) {
+                const auto [first, added] = firstWithTable.try_emplace(MazeHash::hashBytes(table, tableSize), c);
+                if (!added && std::equal(table, table + tableSize, tables.data() + first->second * tableSize)) {
+                    fitnesses[c * mazeCount + k] = fitnesses[first->second * mazeCount + k];
+                    if (archive) {
+                        std::copy_n(behaviourOf(first->second, k), BEHAVIOUR_SIZE, behaviourOf(c, k));
+                    }
+                    PROFILE_COUNT(SharedRollouts, 1);
+                    continue;
+                }
             }
+            rollOut(c, table);
         }
-        // find the direction with the highest score
-        int best = 0;
-        float bestScore = outputs[0];
-        for (int i = 1; i < numOutputs; ++i) {
-            if (outputs[i] > bestScore || (outputs[i] == bestScore && std::rand() % 2)) {
-                bestScore = outputs[i];
-                best = i;
+    };
+    if (pool) {
+        pool->parallelFor(mazeCount, evaluateMaze);
+    }
+    else {
+        for (size_t k = 0; k < mazeCount; ++k) {
+            evaluateMaze(k);
+        }
+    }
+    for (size_t c = 0; c < batch.size(); ++c) {
+        auto &chromosome = batch[c];
+        //reset fitnesses to zero
+        chromosome.fitness = 0.0f;
+        for (size_t k = 0; k < mazeCount; ++k) {
+            chromosome.fitness += fitnesses[c * mazeCount + k];
+        }
+        //normalize the fitness by the number of mazes
+        chromosome.fitness /= static_cast<float>(mazeCount);
+        chromosome.objective = chromosome.fitness;
+    }
+    if (archive) {
+        //behaviours get averaged the same way, into the first maze's slot
+        for (size_t c = 0; c < batch.size(); ++c) {
+            float* behaviour = behaviourOf(c, 0);
+            for (size_t k = 1; k < mazeCount; ++k) {
+                std::transform(behaviour, behaviour + BEHAVIOUR_SIZE, behaviourOf(c, k), behaviour, std::plus{});
+            }
+            for (size_t i = 0; i < BEHAVIOUR_SIZE; ++i) {
+                behaviour[i] /= static_cast<float>(mazeCount);
             }
         }
+        scoreNovelty(batch, behaviours, mazeCount * BEHAVIOUR_SIZE);
+    }
+}
 
-        //move to new cell based on direction unless blocked (waste step)
-        //check for neighbor out of bounds
-        const int neighborX = currentCell % maze.width + dx[best];
-        const int neighborY = currentCell / maze.width + dy[best];
-        if (neighborX < 0 || neighborX >= maze.width || neighborY < 0 || neighborY >= maze.height) {
-            //out of bounds, waste step
-            wallCollisions++;
-            steps++;
-            continue;
+void GeneticAlgorithms::scoreNovelty(std::vector<Chromosome> &batch, const std::vector<float> &behaviours,
+                                     const size_t stride) {
+    PROFILE_SCOPE("score novelty");
+    const auto behaviourOf = [&](const size_t c) {return behaviours.data() + c * stride;};
+    std::vector<float> novelty(batch.size());
+    auto scoreOne = [&](const size_t c) {
+        thread_local std::vector<float> distances;
+        const float* behaviour = behaviourOf(c);
+        archive->nearest(behaviour, noveltyNeighbours, distances);
+        //the rest of the batch counts too, or a batch all doing the same new thing would all look novel
+        for (size_t other = 0; other < batch.size(); ++other) {
+            if (other == c) {
+                continue;
+            }
+            float distance = 0.0f;
+            for (size_t i = 0; i < BEHAVIOUR_SIZE; ++i) {
+                const float diff = behaviour[i] - behaviourOf(other)[i];
+                distance += diff * diff;
+            }
+            distances.push_back(distance);
         }
-        //if direction is blocked, waste step
-        if (maze.cells[currentCell] & wallMasks[best]) {
-            //blocked, waste step
-            wallCollisions++;
-            steps++;
-            continue;
+        const size_t k = std::min(noveltyNeighbours, distances.size());
+        std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+        float sum = 0.0f;
+        for (size_t i = 0; i < k; ++i) {
+            sum += std::sqrt(distances[i]);
         }
-
-        //penalize repeat visit
-        if (visited[neighborY * maze.width + neighborX]) {
-            numRepeats++;
-            steps++;
-            continue;
+        novelty[c] = k > 0 ? sum / static_cast<float>(k) : 0.0f;
+    };
+    if (pool) {
+        pool->parallelFor(batch.size(), scoreOne);
+    }
+    else {
+        for (size_t c = 0; c < batch.size(); ++c) {
+            scoreOne(c);
         }
+    }
+    for (size_t c = 0; c < batch.size(); ++c) {
+        batch[c].fitness = (1.0f - noveltyWeight) * batch[c].objective + noveltyWeight * NOVELTY_SCALE * novelty[c];
+    }
 
-        currentCell = neighborY * maze.width + neighborX; //move to new cell
-        visited[currentCell] = true;
-        if (currentCell == goalCell) {
-            reachedGoal = true; //reached the goal
-            //std::cout << "One reached the goal" << std::endl;
-        }
-        steps++;
+    //the most novel few go in the archive, after scoring so nobody gets measured against themselves
+    const size_t adds = std::min((batch.size() + ARCHIVE_ADD_DIVISOR - 1) / ARCHIVE_ADD_DIVISOR, batch.size());
+    std::vector<size_t> ranked(batch.size());
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::partial_sort(ranked.begin(), ranked.begin() + adds, ranked.end(),
+                      [&](const size_t a, const size_t b) {return novelty[a] > novelty[b];});
+    for (size_t i = 0; i < adds; ++i) {
+        archive->add(behaviourOf(ranked[i]));
     }
-    //calculate fitness score
-    float fitness = 0.0f;
-    fitness += -STEP_PENALTY * steps;
-    fitness += -DISTANCE_BONUS * calculateHeuristic(maze, currentCell, goalCell);
-    fitness += -HIT_PENALTY * wallCollisions; //penalty for hitting a wall
-    fitness += -HIT_PENALTY * numRepeats; //penalty for revisiting a cell
+}
 
-    if (reachedGoal) {
-        fitness += GOAL_BONUS; //bonus for reaching the goal
+void GeneticAlgorithms::setNoveltySearch(const bool enabled, const float weight, const size_t neighbours) {
+    noveltyWeight = std::clamp(weight, 0.0f, 1.0f);
+    noveltyNeighbours = std::max<size_t>(neighbours, 1);
+    if (!enabled) {
+        archive.reset();
+    }
+    else if (!archive) {
+        archive = std::make_unique<NoveltyArchive>(BEHAVIOUR_SIZE);
     }
-    fitness += STEP_PENALTY * MAX_STEPS_PER_MAZE;
-    return fitness;
 }
 
-void GeneticAlgorithms::initPopulation(const size_t populationSize) {
-    population.clear();
-    this->populationSize = populationSize;
-    population.resize(populationSize);
-    for (auto &chromosome : population) {
-        chromosome.genes.resize(numGenes); // Assuming 20 genes for now
-        std::uniform_real_distribution distribution(-1.0f, 1.0f); // Random values between -1 and 1
-        for (auto &gene : chromosome.genes) {
-            gene = distribution(rng); // Randomly initialize genes
+size_t GeneticAlgorithms::getArchiveSize() const {
+    return archive ? archive->size() : 0;
+}
+
+void GeneticAlgorithms::breedBatch(std::vector<Chromosome> &children, const size_t first, const size_t count,
+                                   const size_t streamOffset) const {
+    PROFILE_SCOPE("breed batch");
+    auto breedOne = [&](const size_t i) {
+        //one stream per child, so breeding can be split across threads without changing results
+        RandomStream rng(seed, generation, streamOffset + i, BREED_STREAM);
+        Chromosome parent1 = selectParent(rng);
+        Chromosome parent2 = selectParent(rng);
+        //crossover only if random number is less than crossover rate
+        float chance = rng.nextFloat();
+        Chromosome child = (chance < crossoverRate) ? crossover(parent1, parent2, rng) : parent1;
+        mutate(child, rng);
+        children[first + i] = std::move(child);
+    };
+    if (pool) {
+        pool->parallelFor(count, breedOne);
+    }
+    else {
+        for (size_t i = 0; i < count; ++i) {
+            breedOne(i);
         }
-        chromosome.fitness = 0.0f; // Initialize fitness to 0
     }
-    std::cout << population.size() << " chromosomes generated" << std::endl;
+}
 
+void GeneticAlgorithms::sortElites(const size_t count) {
+    //only the top few need to be in order, partial sort instead of scanning or sorting everything
+    const size_t k = std::clamp<size_t>(count, 1, population.size());
+    std::partial_sort(population.begin(), population.begin() + k, population.end(), fitterThan);
+    if (archive) {
+        keepBestObjective(); //the fittest here is the most novel, not the one that got closest
+    }
+    else {
+        bestChromosome = population.front();
+    }
+}
 
+void GeneticAlgorithms::keepBestObjective() {
+    const auto best = std::ranges::max_element(population, {}, &Chromosome::objective);
+    if (bestChromosome.genes.empty() || best->objective > bestChromosome.objective) {
+        bestChromosome = *best;
+    }
 }
 
-void GeneticAlgorithms::evaluateChromosomes() {
-    //reset fitnesses to zero
-    for (auto &chromosome : population) {
-        chromosome.fitness = 0.0f;
-        //test on each maze
-        for (const auto &maze : mazes) {
-            //evaluate the fitness of the chromosome on the maze
-            const float fitness = evaluate(maze, chromosome);
-            //add the fitness to the chromosome's fitness
-            chromosome.fitness += fitness;
-        }
-        //normalize the fitness by the number of mazes
-        chromosome.fitness /= static_cast<float>(mazes.size());
+float GeneticAlgorithms::averageFitness() const {
+    float avgFitness = 0.0f;
+    for (const auto &chromosome : population) {
+        avgFitness += chromosome.objective;
     }
+    return avgFitness / static_cast<float>(population.size());
+}
+
+void GeneticAlgorithms::setThreadCount(const size_t threadCount) {
+    //the calling thread helps out in parallelFor, so the pool needs one less
+    pool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount - 1) : nullptr;
 }
 
-Chromosome GeneticAlgorithms::selectParent() {
+Chromosome GeneticAlgorithms::selectParent(RandomStream &rng) const {
     constexpr int tournamentSize = 4; //size of tournament
     //pick a parent with highest fitness from a set of randomly selected chromosomes
     std::uniform_int_distribution<int> distribution(0, population.size() - 1);
@@ -207,15 +407,14 @@ Chromosome GeneticAlgorithms::selectParent() {
     return bestParent;
 }
 
-Chromosome GeneticAlgorithms::crossover(const Chromosome& parent1, const Chromosome& parent2) {
+Chromosome GeneticAlgorithms::crossover(const Chromosome& parent1, const Chromosome& parent2, RandomStream &rng) const {
     //crossover between two parents to create a child based on crossover rate.
     //flip a coin for each gene to decide who to take from
     Chromosome child;
     child.genes.resize(numGenes);
     child.fitness = 0.0f;
-    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
     for (int i = 0; i < numGenes; ++i) {
-        float coinflip = distribution(rng);
+        float coinflip = rng.nextFloat();
         if (coinflip < 0.5f) {
             child.genes[i] = parent1.genes[i];
         }
@@ -226,10 +425,10 @@ Chromosome GeneticAlgorithms::crossover(const Chromosome& parent1, const Chromos
     return child;
 }
 
-void GeneticAlgorithms::mutate(Chromosome &chromosome) {
+void GeneticAlgorithms::mutate(Chromosome &chromosome, RandomStream &rng) const {
     std::normal_distribution<float> distribution(0.0f, 0.1f); //random noise for mutation
     for (auto &gene : chromosome.genes) {
-        float coinflip = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+        float coinflip = rng.nextFloat();
         if (coinflip < mutationRate) {
             gene += distribution(rng); //add random noise to gene
             //clamp the gene to -1.0f to 1.0f
@@ -244,10 +443,10 @@ void GeneticAlgorithms::mutate(Chromosome &chromosome) {
 }
 
 void GeneticAlgorithms::selectBestChromosome() {
-    //select the best chromosome from the population, highest fitness
+    //select the best chromosome from the population, highest maze score
     bestChromosome = population[0];
     for (const auto &chromosome : population) {
-        if (chromosome.fitness > bestChromosome.fitness) {
+        if (chromosome.objective > bestChromosome.objective) {
             bestChromosome = chromosome;
         }
     }
@@ -256,46 +455,197 @@ void GeneticAlgorithms::selectBestChromosome() {
 
 void GeneticAlgorithms::train() {
     initPopulation(populationSize);
+    generation = 0;
+    bestChromosome = Chromosome{};
+    optimizer.reset();
+    if (archive) {
+        archive->clear();
+    }
+    runGenerations();
+}
 
-    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
-    for (size_t generation = 0; generation < generationCount; ++generation) {
-        std::cout << "Generation " << generation << std::endl;
-        //error is in these two functions
+bool GeneticAlgorithms::resume(const std::string &fileName) {
+    if (!loadCheckpoint(fileName)) {
+        return false;
+    }
+    std::cout << "Resuming from generation " << generation << std::endl;
+    runGenerations();
+    return true;
+}
+
+void GeneticAlgorithms::runGenerations() {
+    using Clock = std::chrono::steady_clock;
+    auto lastLog = Clock::time_point{};
+
+    //start from the set the last generation was scored on, so a resume that lands on a step up still rescores
+    curriculum.select(generation > 0 ? generation - 1 : 0, generationCount, activeMazes);
+    //the incremental modes carry fitnesses over between generations, so a fresh population gets scored once up front.
+    //so does a resumed one with novelty on, its saved fitnesses were measured against an archive that's gone
+    if ((evolutionMode == EvolutionMode::SteadyState || evolutionMode == EvolutionMode::MuPlusLambda) &&
+        (generation == 0 || archive)) {
         evaluateChromosomes();
-        selectBestChromosome();
-        std::cout << "Best Fitness: " << bestChromosome.fitness << std::endl;
-        //print best weights
+        sortElites(eliteCount);
+    }
+
+    for (; generation < generationCount; ++generation) {
+        PROFILE_SCOPE("generation");
+        const auto generationStart = Clock::now();
+        if (selectMazes()) {
+            rescoreCarriedOver();
+        }
+        GenerationStats stats;
+        size_t evaluated = 0;
+        switch (evolutionMode) {
+            case EvolutionMode::Generational:
+                evaluated = stepGenerational(stats);
+                break;
+            case EvolutionMode::SteadyState:
+                evaluated = stepSteadyState(stats);
+                break;
+            case EvolutionMode::MuPlusLambda:
+                evaluated = stepMuPlusLambda(stats);
+                break;
+            case EvolutionMode::CmaEs:
+                evaluated = stepOptimizer(stats);
+                break;
+        }
+
+        const std::chrono::duration<float> elapsed = Clock::now() - generationStart;
+        stats.generation = generation;
+        stats.generationCount = generationCount;
+        stats.bestFitness = bestChromosome.objective;
+        stats.archiveSize = getArchiveSize();
+        stats.rolloutsPerSecond = elapsed.count() > 0.0f
+            ? static_cast<float>(evaluated * activeMazes.size()) / elapsed.count()
+            : 0.0f;
+        stats.activeMazes = activeMazes.size();
+
+        //printing every generation (and every gene) was a real chunk of the run time, so rate limit it
+        const auto now = Clock::now();
+        if (consoleLogging && std::chrono::duration<float>(now - lastLog).count() >= logInterval) {
+            lastLog = now;
+            std::cout << "Generation " << generation << " Best Fitness: " << stats.bestFitness
+                      << " Average Fitness: " << stats.averageFitness
+                      << " Rollouts/s: " << stats.rolloutsPerSecond;
+            if (curriculum.isEnabled()) {
+                std::cout << " Mazes: " << stats.activeMazes << "/" << mazes.size();
+            }
+            if (archive) {
+                std::cout << " Archive: " << stats.archiveSize;
+            }
+            std::cout << std::endl;
+        }
+
+        const bool stopRequested = generationCallback && !generationCallback(stats);
+        //snapshot is taken after breeding, so it resumes at the next generation.
+        //serializing is a memcpy of the population, the disk write happens on the writer thread
+        if (checkpointWriter && ((generation + 1) % checkpointInterval == 0 || stopRequested)) {
+            checkpointWriter->submit(checkpointFile, serializeCheckpoint(generation + 1));
+        }
+        if (stopRequested) {
+            //leave the index on the next generation so a resume carries on from here
+            ++generation;
+            std::cout << "Training stopped at generation " << generation << std::endl;
+            break;
+        }
+    }
+    if (checkpointWriter) {
+        //make sure the last snapshot is on disk before we report done
+        checkpointWriter->flush();
+    }
+    if (consoleLogging) {
         std::cout << "Best Chromosome: " << std::endl;
         for (const auto &gene : bestChromosome.genes) {
             std::cout << gene << " ";
         }
         std::cout << std::endl;
-        //calc avg fitness and print, to check for improvement
-        float avgFitness = 0.0f;
-        for (const auto &chromosome : population) {
-            avgFitness += chromosome.fitness;
-        }
-        avgFitness /= static_cast<float>(population.size());
-        std::cout << "Average Fitness: " << avgFitness << std::endl;
-
-        std::vector<Chromosome> newPopulation;
-        newPopulation.reserve(populationSize);
-        //push the best chromosome to the new population
-        newPopulation.push_back(bestChromosome);
-        for (size_t i = 0; i < populationSize - 1; ++i) { //-1 because of best chromosome added
-            Chromosome parent1 = selectParent();
-            Chromosome parent2 = selectParent();
-            //crossover only if random number is less than crossover rate
-            float chance = distribution(rng);
-            Chromosome child = (chance < crossoverRate) ? crossover(parent1, parent2) : parent1;
-            mutate(child);
-            newPopulation.push_back(child);
-        }
-        population.swap(newPopulation);
     }
     std::cout << "Training finished" << std::endl;
 }
 
+size_t GeneticAlgorithms::stepGenerational(GenerationStats &stats) {
+    //score everyone, keep the elites, rebuild the rest of the population from scratch
+    //error is in these two functions
+    evaluateChromosomes();
+    sortElites(eliteCount);
+    stats.averageFitness = averageFitness();
+
+    const size_t elites = std::min(eliteCount, populationSize);
+    std::vector<Chromosome> newPopulation(populationSize);
+    //push the best chromosomes to the new population
+    std::copy_n(population.begin(), elites, newPopulation.begin());
+    breedBatch(newPopulation, elites, populationSize - elites, 0);
+    population.swap(newPopulation);
+    return populationSize;
+}
+
+size_t GeneticAlgorithms::stepSteadyState(GenerationStats &stats) {
+    //a generation here is populationSize children, made and scored a few at a time.
+    //each batch goes straight in over the current worst, so good genes get bred from right away
+    const size_t batchSize = std::clamp<size_t>(steadyStateBatch, 1, populationSize);
+    std::vector<Chromosome> children(batchSize);
+    size_t produced = 0;
+    while (produced < populationSize) {
+        const size_t count = std::min(batchSize, populationSize - produced);
+        children.resize(count);
+        breedBatch(children, 0, count, produced);
+        //offset the stream ids past the starting population so no rollout stream gets reused
+        evaluateBatch(children, generation, populationSize + produced);
+
+        std::nth_element(population.begin(), population.end() - count, population.end(), fitterThan);
+        std::move(children.begin(), children.end(), population.end() - count);
+        produced += count;
+    }
+    sortElites(eliteCount);
+    stats.averageFitness = averageFitness();
+    return produced;
+}
+
+size_t GeneticAlgorithms::stepMuPlusLambda(GenerationStats &stats) {
+    //mu parents make lambda children, then the best mu of both together survive
+    const size_t lambda = offspringCount > 0 ? offspringCount : populationSize;
+    std::vector<Chromosome> children(lambda);
+    breedBatch(children, 0, lambda, 0);
+    evaluateBatch(children, generation, populationSize);
+
+    population.insert(population.end(), std::make_move_iterator(children.begin()),
+                      std::make_move_iterator(children.end()));
+    //only need to know who's in the top mu, not their order
+    std::nth_element(population.begin(), population.begin() + populationSize, population.end(), fitterThan);
+    population.resize(populationSize);
+    sortElites(eliteCount);
+    stats.averageFitness = averageFitness();
+    return lambda;
+}
+
+size_t GeneticAlgorithms::stepOptimizer(GenerationStats &stats) {
+    //the population is just this generation's samples, scored by the same batch evaluation as everything else
+    if (!optimizer) {
+        optimizer = std::make_unique<CmaEs>(numGenes, populationSize, seed);
+    }
+    population = optimizer->ask();
+    evaluateBatch(population, generation, 0);
+    if (!optimizer->tell(population)) {
+        std::cerr << "Error: optimiser was told " << population.size() << " samples it didn't hand out" << std::endl;
+    }
+
+    //samples don't survive to the next generation, so hang on to the best one ever seen
+    keepBestObjective();
+    stats.averageFitness = averageFitness();
+    return population.size();
+}
+
+void GeneticAlgorithms::setCheckpointing(const std::string &fileName, const size_t interval) {
+    checkpointFile = fileName;
+    checkpointInterval = interval;
+    if (interval == 0) {
+        checkpointWriter.reset();
+    }
+    else if (!checkpointWriter) {
+        checkpointWriter = std::make_unique<CheckpointWriter>();
+    }
+}
+
 void GeneticAlgorithms::saveBestChromosome(const std::string &fileName) const {
     //save best chromosome genes to binary file
     std::ofstream file{fileName, std::ios::binary};
@@ -309,6 +659,163 @@ void GeneticAlgorithms::saveBestChromosome(const std::string &fileName) const {
     }
 }
 
+bool GeneticAlgorithms::saveCheckpoint(const std::string &fileName) const {
+    return CheckpointWriter::writeAtomic(fileName, serializeCheckpoint(generation));
+}
+
+namespace {
+    //raw little helpers for the checkpoint format, same approach as the .mz files
+    template <typename T>
+    void appendRaw(std::vector<char> &buffer, const T *values, const size_t count) {
+        const auto *bytes = reinterpret_cast<const char*>(values);
+        buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+    }
+
+    template <typename T>
+    void appendRaw(std::vector<char> &buffer, const T &value) {
+        appendRaw(buffer, &value, 1);
+    }
+
+    template <typename T>
+    bool readRaw(std::ifstream &file, T *values, const size_t count) {
+        file.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(file);
+    }
+}
+
+std::vector<char> GeneticAlgorithms::serializeCheckpoint(const size_t resumeGeneration) const {
+    PROFILE_SCOPE("serialize checkpoint");
+    //layout: header, config, best chromosome, then all fitnesses followed by the gene matrix row by row
+    std::vector<char> buffer;
+    buffer.reserve(128 + (population.size() + 1) * (numGenes + 1) * sizeof(float));
+
+    appendRaw(buffer, CHECKPOINT_MAGIC);
+    appendRaw(buffer, CHECKPOINT_VERSION);
+    appendRaw(buffer, static_cast<uint64_t>(resumeGeneration));
+    appendRaw(buffer, seed);
+    appendRaw(buffer, static_cast<uint64_t>(population.size()));
+    appendRaw(buffer, static_cast<uint64_t>(generationCount));
+    appendRaw(buffer, crossoverRate);
+    appendRaw(buffer, mutationRate);
+    appendRaw(buffer, static_cast<uint32_t>(evolutionMode));
+    appendRaw(buffer, static_cast<uint64_t>(eliteCount));
+    appendRaw(buffer, static_cast<uint64_t>(offspringCount));
+    appendRaw(buffer, static_cast<uint64_t>(steadyStateBatch));
+    appendRaw(buffer, static_cast<uint64_t>(numGenes));
+
+    std::vector<float> bestGenes = bestChromosome.genes;
+    bestGenes.resize(numGenes, 0.0f); //nothing evaluated yet, store zeros
+    appendRaw(buffer, bestChromosome.objective); //the same as its fitness unless novelty search is on
+    appendRaw(buffer, bestGenes.data(), numGenes);
+
+    for (const auto &chromosome : population) {
+        appendRaw(buffer, chromosome.fitness);
+    }
+    for (const auto &chromosome : population) {
+        appendRaw(buffer, chromosome.genes.data(), numGenes);
+    }
+
+    //optimiser state goes last, length first so an empty one is just a zero
+    const std::vector<double> optimizerState = optimizer ? optimizer->getState() : std::vector<double>{};
+    appendRaw(buffer, static_cast<uint64_t>(optimizerState.size()));
+    appendRaw(buffer, optimizerState.data(), optimizerState.size());
+    return buffer;
+}
+
+bool GeneticAlgorithms::loadCheckpoint(const std::string &fileName) {
+    std::ifstream file{fileName, std::ios::binary};
+    if (!file) {
+        std::cerr << "Error opening file for reading: " << fileName << std::endl;
+        return false;
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t savedGeneration = 0;
+    uint64_t savedSeed = 0;
+    uint64_t savedPopulation = 0;
+    uint64_t savedGenerationCount = 0;
+    float savedCrossover = 0.0f;
+    float savedMutation = 0.0f;
+    uint32_t savedMode = 0;
+    uint64_t savedElites = 0;
+    uint64_t savedOffspring = 0;
+    uint64_t savedBatch = 0;
+    uint64_t savedGenes = 0;
+    bool ok = readRaw(file, &magic, 1) && readRaw(file, &version, 1);
+    if (!ok || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+        std::cerr << "Error: " << fileName << " is not a checkpoint this version can read" << std::endl;
+        return false;
+    }
+    ok = readRaw(file, &savedGeneration, 1) && readRaw(file, &savedSeed, 1) &&
+         readRaw(file, &savedPopulation, 1) && readRaw(file, &savedGenerationCount, 1) &&
+         readRaw(file, &savedCrossover, 1) && readRaw(file, &savedMutation, 1) &&
+         readRaw(file, &savedMode, 1) && readRaw(file, &savedElites, 1) &&
+         readRaw(file, &savedOffspring, 1) && readRaw(file, &savedBatch, 1) &&
+         readRaw(file, &savedGenes, 1);
+    //the population size sizes an allocation, so it has to fit in what's left of the file before it's trusted.
+    //a corrupt count would otherwise throw out of resume(), and on the training thread that takes the gui with it
+    const auto headerEnd = file.tellg();
+    file.seekg(0, std::ios::end);
+    const auto remaining = static_cast<uint64_t>(file.tellg() - headerEnd);
+    file.seekg(headerEnd);
+    const uint64_t chromosomeBytes = sizeof(float) * (1 + numGenes);
+    if (!ok || savedGenes != numGenes || savedPopulation == 0 || savedPopulation > remaining / chromosomeBytes ||
+        savedMode > static_cast<uint32_t>(EvolutionMode::CmaEs)) {
+        std::cerr << "Error: checkpoint " << fileName << " does not match this policy layout" << std::endl;
+        return false;
+    }
+
+    Chromosome savedBest;
+    savedBest.genes.resize(numGenes);
+    std::vector<Chromosome> savedChromosomes(savedPopulation);
+    ok = readRaw(file, &savedBest.fitness, 1) && readRaw(file, savedBest.genes.data(), numGenes);
+    for (auto &chromosome : savedChromosomes) {
+        ok = ok && readRaw(file, &chromosome.fitness, 1);
+    }
+    for (auto &chromosome : savedChromosomes) {
+        chromosome.genes.resize(numGenes);
+        ok = ok && readRaw(file, chromosome.genes.data(), numGenes);
+    }
+    uint64_t optimizerSize = 0;
+    ok = ok && readRaw(file, &optimizerSize, 1) && optimizerSize < (1u << 20);
+    std::vector<double> optimizerState(ok ? optimizerSize : 0);
+    ok = ok && readRaw(file, optimizerState.data(), optimizerState.size());
+    if (!ok) {
+        std::cerr << "Error: checkpoint " << fileName << " is truncated" << std::endl;
+        return false;
+    }
+
+    //only touch our state once the whole file has been read
+    generation = savedGeneration;
+    seed = savedSeed;
+    populationSize = savedPopulation;
+    generationCount = savedGenerationCount;
+    crossoverRate = savedCrossover;
+    mutationRate = savedMutation;
+    evolutionMode = static_cast<EvolutionMode>(savedMode);
+    eliteCount = savedElites;
+    offspringCount = savedOffspring;
+    steadyStateBatch = savedBatch;
+    savedBest.objective = savedBest.fitness;
+    for (auto &chromosome : savedChromosomes) {
+        chromosome.objective = chromosome.fitness;
+    }
+    bestChromosome = std::move(savedBest);
+    population = std::move(savedChromosomes);
+    if (archive) {
+        archive->clear();
+    }
+    optimizer.reset();
+    if (!optimizerState.empty()) {
+        optimizer = std::make_unique<CmaEs>(numGenes, populationSize, seed);
+        if (!optimizer->setState(optimizerState)) {
+            std::cerr << "Warning: optimiser state in " << fileName << " doesn't fit, starting it over" << std::endl;
+            optimizer.reset();
+        }
+    }
+    return true;
+}
+
 int GeneticAlgorithms::calculateHeuristic(const Maze& maze, const int currentCell, const int targetCell) {
     //return heuristic; which is manhattan distance
     const int currentX = currentCell % maze.width;
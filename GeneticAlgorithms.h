@@ -1,11 +1,17 @@
 
 #ifndef GENETICALGORITHMS_H
 #define GENETICALGORITHMS_H
+#include <functional>
+#include <memory>
 #include <random>
 #include <vector>
-#include <__filesystem/directory_iterator.h>
 
+#include "CheckpointWriter.h"
+#include "Curriculum.h"
 #include "Generator.h"
+#include "Random.h"
+#include "RolloutKernel.h"
+#include "ThreadPool.h"
 
 /*
  * this class handles genetic algos and training the agent to solve mazes with policy
@@ -17,27 +23,91 @@
 struct Chromosome {
     //store dna for evolution
     std::vector<float> genes; //linear weights to apply to choices, should be about 20 (5 input * 4 outputs)
-    float fitness{0}; //fitness score for the chromosome
+    float fitness{0}; //fitness score for the chromosome, what selection goes on
+    float objective{0}; //the maze score on its own, same as fitness unless novelty search is mixed in
 
 };
 
+//per generation numbers, handed to whoever is watching the run (gui, console)
+struct GenerationStats {
+    size_t generation{0};
+    size_t generationCount{0};
+    float bestFitness{0};
+    float averageFitness{0};
+    float rolloutsPerSecond{0}; //chromosome x maze evaluations per second this generation
+    size_t activeMazes{0}; //how many of the mazes this generation was scored on, less than all with a curriculum
+    size_t archiveSize{0}; //behaviours kept by novelty search, 0 when it's off
+};
+
+//how the next generation gets made. generational rebuilds the whole population every time,
+//steady state swaps a few children in over the worst at a time, mu+lambda keeps the best of parents and children,
+//cma-es drops crossover altogether and samples each generation from a learned gaussian
+enum class EvolutionMode {
+    Generational = 0,
+    SteadyState = 1,
+    MuPlusLambda = 2,
+    CmaEs = 3
+};
+
+class Optimizer;
+class NoveltyArchive;
+
+//called once per generation from the training thread, return false to stop the run
+using GenerationCallback = std::function<bool(const GenerationStats&)>;
+
 class GeneticAlgorithms {
 public:
-    GeneticAlgorithms(size_t populationSize, size_t generationCount, float crossoverRate, float mutationRate);
-    ~GeneticAlgorithms() = default;
+    GeneticAlgorithms(size_t populationSize, size_t generationCount, float crossoverRate, float mutationRate,
+                      uint64_t seed = std::random_device{}());
+    ~GeneticAlgorithms(); //out of line, Optimizer is only forward declared here
 
     void loadMazes(const std::string& folderPath);
+    void loadMazes(const std::vector<std::string>& fileNames); //e.g. a filtered selection from MazeAnalytics
+    void setMazes(std::vector<Maze> mazes); //mazes already in memory, e.g. straight from a Generator
 
-    [[nodiscard]] float evaluate(const Maze& maze, const Chromosome& chromosome) const;
+    [[nodiscard]] float evaluate(const Maze& maze, const Chromosome& chromosome, RandomStream& rng) const;
     void initPopulation(size_t populationSize);
     void evaluateChromosomes();
-    Chromosome selectParent();
-    Chromosome crossover(const Chromosome& parent1, const Chromosome& parent2);
-    void mutate(Chromosome& chromosome);
+    Chromosome selectParent(RandomStream& rng) const;
+    Chromosome crossover(const Chromosome& parent1, const Chromosome& parent2, RandomStream& rng) const;
+    void mutate(Chromosome& chromosome, RandomStream& rng) const;
     void selectBestChromosome();
     void train();
+    bool resume(const std::string& fileName); //pick a run back up from a checkpoint, mazes must be loaded first
     void saveBestChromosome(const std::string& fileName) const;
 
+    //full population snapshots: genes, fitnesses, config and generation index. the rng needs no extra
+    //state since every stream is rebuilt from the seed and generation
+    bool saveCheckpoint(const std::string& fileName) const;
+    bool loadCheckpoint(const std::string& fileName);
+    void setCheckpointing(const std::string& fileName, size_t interval); //interval 0 turns it off
+
+    void setEvolutionMode(const EvolutionMode mode) {evolutionMode = mode;}
+    [[nodiscard]] EvolutionMode getEvolutionMode() const {return evolutionMode;}
+    void setEliteCount(const size_t count) {eliteCount = count;} //top k carried over / kept sorted
+    void setOffspringCount(const size_t count) {offspringCount = count;} //lambda, 0 means same as population
+    void setSteadyStateBatch(const size_t count) {steadyStateBatch = count;} //children scored per steady state tick
+    void setThreadCount(size_t threadCount); //rollout and breeding threads, 1 runs everything on the caller
+    //easy mazes first, see Curriculum. not part of the checkpoint, resume with the same settings
+    void setCurriculum(const bool enabled, const float startFraction = 0.25f, const float rampFraction = 0.5f) {
+        curriculum.setSchedule(enabled, startFraction, rampFraction);
+    }
+    [[nodiscard]] bool isCurriculumEnabled() const {return curriculum.isEnabled();}
+    //novelty search: selection goes (weight of the way) on how far a chromosome's behaviour is from its k
+    //nearest in the archive and the rest of its batch, instead of only on the maze score, which is easy to get
+    //stuck on when the goal is behind a wall. best chromosome and the reported fitnesses stay the maze score.
+    //the archive isn't part of the checkpoint, a resumed run starts it again
+    void setNoveltySearch(bool enabled, float weight = 1.0f, size_t neighbours = 15);
+    [[nodiscard]] bool isNoveltySearchEnabled() const {return archive != nullptr;}
+    [[nodiscard]] size_t getArchiveSize() const;
+
+    void setGenerationCallback(GenerationCallback callback) {generationCallback = std::move(callback);}
+    //console output is optional and printed at most once per interval, the full chromosome only at the end
+    void setConsoleLogging(const bool enabled, const float intervalSeconds = 1.0f) {
+        consoleLogging = enabled;
+        logInterval = intervalSeconds;
+    }
+
     static int calculateHeuristic(const Maze& maze, int currentCell, int targetCell);
 
     [[nodiscard]] Chromosome getBestChromosome() const;
@@ -47,14 +117,38 @@ public:
     void setPopulationSize(size_t populationSize) {this->populationSize = populationSize;}
     [[nodiscard]] const std::vector<Chromosome>& getPopulation() const{return population;}
     [[nodiscard]] const std::vector<Maze>& getMazes() const {return mazes;}
+    [[nodiscard]] const std::vector<MazeDifficulty>& getDifficulties() const {return difficulties;} //same order
     [[nodiscard]] static int getNumGenes() {return numGenes;}
     static int getNumInputs() {return numInputs;}
     static int getNumOutputs() {return numOutputs;}
     static int getMaxSteps() {return MAX_STEPS_PER_MAZE;}
+    void setSeed(uint64_t seed) {this->seed = seed;}
+    [[nodiscard]] uint64_t getSeed() const {return seed;}
+    [[nodiscard]] size_t getGeneration() const {return generation;}
 
 
 
 private:
+    void runGenerations();
+    void prepareMazes();
+    bool selectMazes(); //true if the active set changed
+    void rescoreCarriedOver();
+    static float scoreRollout(const PreparedMaze& maze, const RolloutState& rollout);
+    static void describeRollout(const PreparedMaze& maze, const RolloutState& rollout, const RolloutTrace& trace,
+                                float* behaviour);
+    void evaluateBatch(std::vector<Chromosome>& batch, uint64_t streamGeneration, size_t streamOffset);
+    void scoreNovelty(std::vector<Chromosome>& batch, const std::vector<float>& behaviours, size_t stride);
+    void keepBestObjective();
+    void breedBatch(std::vector<Chromosome>& children, size_t first, size_t count, size_t streamOffset) const;
+    void sortElites(size_t count);
+    [[nodiscard]] float averageFitness() const;
+    size_t stepGenerational(GenerationStats& stats);
+    size_t stepSteadyState(GenerationStats& stats);
+    size_t stepMuPlusLambda(GenerationStats& stats);
+    size_t stepOptimizer(GenerationStats& stats);
+    static bool fitterThan(const Chromosome& a, const Chromosome& b) {return a.fitness > b.fitness;}
+    [[nodiscard]] std::vector<char> serializeCheckpoint(size_t resumeGeneration) const;
+
     size_t populationSize;
     size_t generationCount;
     float crossoverRate{0.5}; //probability of crossover
@@ -63,11 +157,43 @@ private:
     Chromosome bestChromosome;
 
     std::vector<Maze> mazes;
+    std::vector<PreparedMaze> preparedMazes; //same order as mazes
+    std::vector<MazeDifficulty> difficulties; //same order as mazes, measured once when they're set
+    Curriculum curriculum;
+    std::vector<uint32_t> activeMazes; //the ones rollouts go through this generation, all of them without a curriculum
+
+    EvolutionMode evolutionMode{EvolutionMode::Generational};
+    size_t eliteCount{1};
+    size_t offspringCount{0};
+    size_t steadyStateBatch{8};
+    std::unique_ptr<ThreadPool> pool; //null when running single threaded
+    std::unique_ptr<Optimizer> optimizer; //cma-es state, population size is its lambda
+    std::unique_ptr<NoveltyArchive> archive; //null unless novelty search is on
+    float noveltyWeight{1.0f};
+    size_t noveltyNeighbours{15};
+
+    //periodic checkpoints, written off the training thread
+    std::string checkpointFile;
+    size_t checkpointInterval{0};
+    std::unique_ptr<CheckpointWriter> checkpointWriter;
+    static constexpr uint32_t CHECKPOINT_MAGIC = 0x4B434D47; //"GMCK" in the file
+    static constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+    GenerationCallback generationCallback;
+    bool consoleLogging{true};
+    float logInterval{1.0f};
 
     static constexpr size_t MAX_GENERATIONS = 1000;
     static constexpr size_t MAX_POPULATION = 500;
     static constexpr size_t MAX_STEPS_PER_MAZE = 1000; //max steps to take in a maze
+    static constexpr size_t LOAD_BATCH_SIZE = 64; //maze files per read batch in loadMazes
+    static constexpr size_t ACTION_TABLE_MAX_CELLS = 1024; //mazes up to this size get rolled out off action tables
+    //behaviour: where it ended up (x, y) then the share of its steps in each region of the maze, averaged over mazes
+    static constexpr size_t BEHAVIOUR_SIZE = 2 + RolloutTrace::SIDE * RolloutTrace::SIDE;
+    static constexpr size_t ARCHIVE_ADD_DIVISOR = 16; //the most novel 1 in this many of each batch are archived
     static constexpr int GOAL_BONUS = 1000; //bonus for reaching the goal
+    //behaviour distances are 0 to about 2, this puts the far end of that level with reaching the goal
+    static constexpr float NOVELTY_SCALE = GOAL_BONUS;
     static constexpr float STEP_PENALTY = 1.0f; //penalty for each step taken
     static constexpr float HIT_PENALTY = 2.0f; //penalty for hitting a wall
     static constexpr float DISTANCE_BONUS = 2.0f; //bonus for distance to goal, smaller is better
@@ -76,7 +202,12 @@ private:
     static constexpr size_t numGenes = numInputs * numOutputs; //number of genes in the chromosome
 
 
-    std::mt19937 rng;
+    //all randomness comes from streams keyed on (seed, generation, chromosome, maze), nothing is shared.
+    //breeding and init use the maze slot with these ids so they never overlap a rollout stream
+    uint64_t seed;
+    size_t generation{0};
+    static constexpr uint64_t INIT_STREAM = ~0ull;
+    static constexpr uint64_t BREED_STREAM = ~0ull - 1;
 
     // direction arrays
     //   0 = Up    (north)
@@ -0,0 +1,191 @@
+#include "IncrementalSolver.h"
+#include <algorithm>
+#include <cstdlib>
+
+#include "Generator.h"
+#include "Profiler.h"
+
+IncrementalSolver::IncrementalSolver(MazeHandle maze) {
+    rebuild(std::move(maze));
+}
+
+void IncrementalSolver::rebuild(MazeHandle maze) {
+    this->maze = std::move(maze);
+    width = this->maze ? static_cast<int>(this->maze->width) : 0;
+    height = this->maze ? static_cast<int>(this->maze->height) : 0;
+    setEndpoints(0, 0, width - 1, height - 1);
+}
+
+void IncrementalSolver::setEndpoints(const int startX, const int startY, const int goalX, const int goalY) {
+    const size_t cellCount = static_cast<size_t>(width) * height;
+    g.assign(cellCount, INF);
+    rhs.assign(cellCount, INF);
+    open.clear();
+    expanded = 0;
+    if (cellCount == 0) {
+        return;
+    }
+    start = startY * width + startX;
+    goal = goalY * width + goalX;
+    this->goalX = goalX;
+    this->goalY = goalY;
+    //the start is the one cell whose rhs isn't worked out from its neighbours
+    rhs[start] = 0;
+    push(start);
+}
+
+uint64_t IncrementalSolver::keyOf(const int32_t cell) const {
+    const int32_t best = std::min(g[cell], rhs[cell]);
+    const int32_t heuristic = std::abs(cell % width - goalX) + std::abs(cell / width - goalY);
+    return static_cast<uint64_t>(best + heuristic) << 32 | static_cast<uint32_t>(best);
+}
+
+int32_t IncrementalSolver::neighbor(const int32_t cell, const int direction) const {
+    const int x = cell % width + dx[direction];
+    const int y = cell / width + dy[direction];
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        return -1;
+    }
+    const int32_t next = y * width + x;
+    //walled if either side says so, so a lopsided file can't make a one way passage
+    const std::vector<uint8_t>& cells = maze->cells;
+    if ((cells[cell] & wallMasks[direction]) || (cells[next] & oppositeMasks[direction])) {
+        return -1;
+    }
+    return next;
+}
+
+void IncrementalSolver::updateCell(const int32_t cell) {
+    if (cell != start) {
+        int32_t best = INF;
+        for (int direction = 0; direction < 4; ++direction) {
+            const int32_t next = neighbor(cell, direction);
+            if (next >= 0) {
+                best = std::min(best, g[next] + 1);
+            }
+        }
+        rhs[cell] = std::min(best, INF);
+    }
+    if (g[cell] != rhs[cell]) {
+        push(cell);
+    }
+}
+
+void IncrementalSolver::push(const int32_t cell) {
+    open.push_back({keyOf(cell), cell});
+    std::ranges::push_heap(open, LaterKey{});
+}
+
+void IncrementalSolver::compactQueue() {
+    //copies whose cell has moved on (consistent now, or pushed again with a newer key) can go
+    std::erase_if(open, [&](const QueueEntry& entry) {
+        return g[entry.cell] == rhs[entry.cell] || entry.key != keyOf(entry.cell);
+    });
+    std::ranges::make_heap(open, LaterKey{});
+}
+
+void IncrementalSolver::applyEdits(const std::span<const WallEdit> edits) {
+    if (edits.empty() || !maze) {
+        return;
+    }
+    //copied first if anyone else still holds this version, after that edits land in place
+    Maze& edited = maze.edit();
+    for (const WallEdit& edit : edits) {
+        const int x = edit.x + dx[edit.direction & 3];
+        const int y = edit.y + dy[edit.direction & 3];
+        if (edit.x < 0 || edit.x >= width || edit.y < 0 || edit.y >= height || x < 0 || x >= width || y < 0 ||
+            y >= height) {
+            continue; //border walls stay where they are
+        }
+        const int32_t cell = edit.y * width + edit.x;
+        const int32_t next = y * width + x;
+        const bool walled = neighbor(cell, edit.direction & 3) < 0;
+        if (walled == edit.wall) {
+            continue;
+        }
+        if (edit.wall) {
+            Generator::addWall(edited, edit.x, edit.y, edit.direction & 3);
+        }
+        else {
+            Generator::removeWall(edited, edit.x, edit.y, edit.direction & 3);
+        }
+        //only the two cells either side of the wall see a different set of neighbours, the rest follows from
+        //whatever they change when solve() expands them
+        updateCell(cell);
+        updateCell(next);
+    }
+}
+
+bool IncrementalSolver::solve() {
+    PROFILE_SCOPE("lpa solve");
+    expanded = 0;
+    if (g.empty()) {
+        return false;
+    }
+    if (open.size() > COMPACT_MIN && open.size() > g.size()) {
+        compactQueue();
+    }
+    while (!open.empty()) {
+        const QueueEntry top = open.front();
+        if (g[top.cell] == rhs[top.cell] || top.key != keyOf(top.cell)) {
+            std::ranges::pop_heap(open, LaterKey{}); //stale copy
+            open.pop_back();
+            continue;
+        }
+        //done once nothing left on the heap could change the goal's cost
+        if (top.key >= keyOf(goal) && g[goal] == rhs[goal]) {
+            break;
+        }
+        std::ranges::pop_heap(open, LaterKey{});
+        open.pop_back();
+        ++expanded;
+        const int32_t cell = top.cell;
+        if (g[cell] > rhs[cell]) {
+            //found a cheaper way here, settle it and let the neighbours know
+            g[cell] = rhs[cell];
+        }
+        else {
+            //got more expensive (a wall went up on its best route), forget it and work it out again
+            g[cell] = INF;
+            updateCell(cell);
+        }
+        for (int direction = 0; direction < 4; ++direction) {
+            const int32_t next = neighbor(cell, direction);
+            if (next >= 0) {
+                updateCell(next);
+            }
+        }
+    }
+    PROFILE_COUNT(NodesExpanded, expanded);
+    return g[goal] < INF;
+}
+
+void IncrementalSolver::getSolution(std::vector<int> &solution) const {
+    solution.clear();
+    if (g.empty() || g[goal] >= INF) {
+        return;
+    }
+    //back from the goal, always to the neighbour that's closest to the start
+    int32_t cell = goal;
+    solution.push_back(cell);
+    while (cell != start) {
+        int32_t best = -1;
+        for (int direction = 0; direction < 4; ++direction) {
+            const int32_t next = neighbor(cell, direction);
+            if (next >= 0 && (best < 0 || g[next] < g[best])) {
+                best = next;
+            }
+        }
+        if (best < 0 || g[best] >= INF || solution.size() > g.size()) {
+            solution.clear(); //only happens if solve() wasn't called since the last edit
+            return;
+        }
+        cell = best;
+        solution.push_back(cell);
+    }
+    std::ranges::reverse(solution);
+}
+
+int IncrementalSolver::getPathLength() const {
+    return g.empty() || g[goal] >= INF ? 0 : g[goal] + 1;
+}
@@ -0,0 +1,94 @@
+#ifndef INCREMENTALSOLVER_H
+#define INCREMENTALSOLVER_H
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Maze.h"
+
+/*
+ * lifelong planning A* (LPA*) between two fixed cells, for mazes that get walls knocked down or put back while
+ * they're being solved. every cell keeps g (best cost found so far) and rhs (one step lookahead off its
+ * neighbours' g), and only cells where the two disagree go back on the heap. so after an edit only the cells
+ * whose distance actually changed get expanded again, an edit away from the search is a couple of heap pushes
+ * instead of a whole A* over the maze.
+ * steps all cost 1 and the heuristic is manhattan, so keys are ints packed into one 64 bit compare. the heap is
+ * lazy: a cell is pushed again whenever its key changes and copies that went stale are skipped as they come up.
+ * edits go through the maze handle like everywhere else, so anyone still holding the old version keeps it
+ */
+
+//one wall changing, on the given side of (x, y) and the matching side of the neighbour
+struct WallEdit {
+    int x{0};
+    int y{0};
+    int direction{0}; //Direction, 0 = up, 1 = right, 2 = down, 3 = left
+    bool wall{true}; //true puts the wall up, false knocks it down
+};
+
+class IncrementalSolver {
+public:
+    //start top left and goal bottom right, like the rest of the code
+    explicit IncrementalSolver(MazeHandle maze);
+
+    //a different maze or different endpoints throw the search away, the next solve starts from scratch
+    void rebuild(MazeHandle maze);
+    void setEndpoints(int startX, int startY, int goalX, int goalY);
+
+    //changes the walls and marks the cells either side for repair. cheap, the next solve() does the work.
+    //edits on the border or that don't change anything are skipped
+    void applyEdits(std::span<const WallEdit> edits);
+    //brings the search up to date and returns whether the goal can be reached. the first call costs about what
+    //an A* does, after that it's proportional to how much the edits since the last call changed
+    bool solve();
+
+    //cells from start to goal, empty if it can't be reached. walks back along g, so it's O(path), not O(maze)
+    void getSolution(std::vector<int>& solution) const;
+    [[nodiscard]] int getPathLength() const; //cells on the path, 0 if unreachable
+    [[nodiscard]] size_t getExpanded() const {return expanded;} //cells the last solve() expanded
+    [[nodiscard]] const MazeHandle& getHandle() const {return maze;}
+
+private:
+    struct QueueEntry {
+        uint64_t key; //(min(g, rhs) + h) << 32 | min(g, rhs), so one compare orders by f then g
+        int32_t cell;
+    };
+    //min heap on the key for std::push_heap/pop_heap
+    struct LaterKey {
+        bool operator()(const QueueEntry& lhs, const QueueEntry& rhs) const {return lhs.key > rhs.key;}
+    };
+
+    [[nodiscard]] uint64_t keyOf(int32_t cell) const;
+    [[nodiscard]] int32_t neighbor(int32_t cell, int direction) const; //-1 if walled off or off the grid
+    void updateCell(int32_t cell);
+    void push(int32_t cell);
+    void compactQueue();
+
+    MazeHandle maze;
+    int width{0};
+    int height{0};
+    int32_t start{0};
+    int32_t goal{0};
+    int goalX{0};
+    int goalY{0};
+
+    std::vector<int32_t> g;
+    std::vector<int32_t> rhs;
+    std::vector<QueueEntry> open;
+    size_t expanded{0};
+
+    static constexpr int32_t INF = INT32_MAX / 4; //unreachable, with room to add a step and a heuristic
+    static constexpr size_t COMPACT_MIN = 1 << 12; //stale entries get cleared out once the heap is past this
+
+    static constexpr int dx[4] = {  0, +1,  0, -1 };
+    static constexpr int dy[4] = { -1,  0, +1,  0 };
+    static constexpr uint8_t WALL_N = 1 << 0;
+    static constexpr uint8_t WALL_S = 1 << 1;
+    static constexpr uint8_t WALL_E = 1 << 2;
+    static constexpr uint8_t WALL_W = 1 << 3;
+    static constexpr uint8_t wallMasks[4] = {WALL_N, WALL_E, WALL_S, WALL_W};
+    static constexpr uint8_t oppositeMasks[4] = {WALL_S, WALL_W, WALL_N, WALL_E};
+};
+
+
+
+#endif //INCREMENTALSOLVER_H
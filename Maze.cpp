@@ -0,0 +1,27 @@
+#include "Maze.h"
+#include <atomic>
+
+Maze &MazeHandle::edit() {
+    if (!maze) {
+        maze = std::make_shared<Maze>();
+    }
+    else if (maze.use_count() > 1) {
+        //someone else is still looking at it, they keep the old one
+        maze = std::make_shared<Maze>(*maze);
+    }
+    stamp = nextVersion();
+    return *maze;
+}
+
+Maze &MazeHandle::rewrite() {
+    if (!maze || maze.use_count() > 1) {
+        maze = std::make_shared<Maze>();
+    }
+    stamp = nextVersion();
+    return *maze;
+}
+
+uint64_t MazeHandle::nextVersion() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
@@ -0,0 +1,51 @@
+#ifndef MAZE_H
+#define MAZE_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//wall bits, one byte per cell, row major
+struct Maze {
+    size_t width{0}, height{0};
+    std::vector<uint8_t> cells;
+};
+
+/*
+ * shared, read only maze that the generator, solver, simulation and renderer all hold instead of copying.
+ * copying a handle is a refcount bump, the cells are never duplicated just to pass a maze around.
+ * every change goes through edit()/rewrite() and gets a new version number, so anything caching off a maze
+ * (the renderer's mesh, a solver's buffers) can tell it changed by comparing versions instead of cells.
+ * copy on write: if nobody else holds the maze it's changed in place, otherwise the editor gets its own copy
+ * first and everyone else keeps seeing the version they had, so a 10^7 cell maze on screen never gets
+ * changed under the renderer and a fresh generate doesn't have to wait for the animation to let go of the old one
+ */
+
+class MazeHandle {
+public:
+    MazeHandle() = default;
+    explicit MazeHandle(Maze maze) : maze(std::make_shared<Maze>(std::move(maze))), stamp(nextVersion()) {}
+
+    [[nodiscard]] const Maze& operator*() const {return *maze;}
+    [[nodiscard]] const Maze* operator->() const {return maze.get();}
+    [[nodiscard]] const Maze* get() const {return maze.get();}
+    explicit operator bool() const {return maze != nullptr;}
+    //unique across every handle, 0 for an empty one. same version means same cells
+    [[nodiscard]] uint64_t version() const {return stamp;}
+
+    //writable maze with the current contents, copied first if it's shared
+    Maze& edit();
+    //writable maze for a caller that's about to overwrite all of it. when it's shared it starts empty instead
+    //of being copied, when it isn't the old buffers come back as they were so their capacity gets reused
+    Maze& rewrite();
+
+private:
+    static uint64_t nextVersion();
+
+    std::shared_ptr<Maze> maze;
+    uint64_t stamp{0};
+};
+
+
+
+#endif //MAZE_H
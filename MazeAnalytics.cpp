@@ -0,0 +1,285 @@
+#include "MazeAnalytics.h"
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "AsyncIO.h"
+#include "CheckpointWriter.h"
+#include "MazeHash.h"
+#include "MazePrefetcher.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+    //union-find over cell indices. a root holds its set's size negated, everything else its parent
+    struct DisjointSets {
+        std::vector<int32_t> parent;
+
+        explicit DisjointSets(const size_t count) : parent(count, -1) {}
+
+        int32_t find(int32_t cell) {
+            while (parent[cell] >= 0) {
+                //path halving, skip every other link on the way up
+                if (parent[parent[cell]] >= 0) {
+                    parent[cell] = parent[parent[cell]];
+                }
+                cell = parent[cell];
+            }
+            return cell;
+        }
+
+        //false if they were already in the same set
+        bool unite(int32_t a, int32_t b) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return false;
+            }
+            if (parent[a] > parent[b]) {
+                std::swap(a, b); //bigger set stays the root
+            }
+            parent[a] += parent[b];
+            parent[b] = a;
+            return true;
+        }
+    };
+
+    //raw little helpers for the index format, same approach as the checkpoints
+    template <typename T>
+    void appendRaw(std::vector<char> &buffer, const T &value) {
+        const auto *bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool readRaw(std::ifstream &file, T &value) {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return static_cast<bool>(file);
+    }
+}
+
+MazeStats MazeAnalytics::analyse(const Maze &maze, const bool symmetric) {
+    PROFILE_SCOPE("analyse maze");
+    MazeStats stats;
+    const size_t width = maze.width;
+    const size_t height = maze.height;
+    const size_t cellCount = width * height;
+    stats.width = static_cast<uint32_t>(width);
+    stats.height = static_cast<uint32_t>(height);
+    if (cellCount == 0) {
+        return stats;
+    }
+
+    //ways out of a cell from its own wall bits, border walls count as walls whatever the file says
+    const auto degreeOf = [&](const size_t x, const size_t y) {
+        const uint8_t walls = maze.cells[y * width + x];
+        return (y > 0 && !(walls & WALL_N)) + (y + 1 < height && !(walls & WALL_S)) +
+               (x + 1 < width && !(walls & WALL_E)) + (x > 0 && !(walls & WALL_W));
+    };
+
+    DisjointSets passages(cellCount);
+    DisjointSets corridors(cellCount);
+    //degrees for this row and the one below, each row is worked out once as the sweep reaches it
+    std::vector<uint8_t> row(width);
+    std::vector<uint8_t> below(width);
+    for (size_t x = 0; x < width; ++x) {
+        row[x] = static_cast<uint8_t>(degreeOf(x, 0));
+    }
+    uint32_t corridorCells = 0;
+    for (size_t y = 0; y < height; ++y) {
+        if (y + 1 < height) {
+            for (size_t x = 0; x < width; ++x) {
+                below[x] = static_cast<uint8_t>(degreeOf(x, y + 1));
+            }
+        }
+        for (size_t x = 0; x < width; ++x) {
+            const auto cell = static_cast<int32_t>(y * width + x);
+            const uint8_t walls = maze.cells[cell];
+            const uint8_t degree = row[x];
+            stats.deadEnds += degree == 1;
+            stats.junctions += degree >= 3;
+            corridorCells += degree == 2;
+            //each passage is seen once, from its west/north end
+            if (x + 1 < width && !(walls & WALL_E)) {
+                stats.loops += !passages.unite(cell, cell + 1);
+                if (degree == 2 && row[x + 1] == 2) {
+                    corridors.unite(cell, cell + 1);
+                }
+            }
+            if (y + 1 < height && !(walls & WALL_S)) {
+                const auto south = static_cast<int32_t>(cell + width);
+                stats.loops += !passages.unite(cell, south);
+                if (degree == 2 && below[x] == 2) {
+                    corridors.unite(cell, south);
+                }
+            }
+        }
+        std::swap(row, below);
+    }
+
+    //roots are what's left, one per component / corridor. this walks the sets, not the maze
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            const size_t cell = y * width + x;
+            stats.components += passages.parent[cell] < 0;
+            if (corridors.parent[cell] < 0 && degreeOf(x, y) == 2) {
+                const auto length = static_cast<uint32_t>(-corridors.parent[cell]);
+                const size_t bucket = std::min<size_t>(std::bit_width(length) - 1, MazeStats::CORRIDOR_BUCKETS - 1);
+                ++stats.corridors[bucket];
+            }
+        }
+    }
+    stats.riverFactor = static_cast<float>(corridorCells) / static_cast<float>(cellCount);
+    stats.difficulty = Curriculum::measure(maze);
+    stats.hash = MazeHash::hash(maze);
+    if (symmetric) {
+        stats.canonicalHash = MazeHash::canonicalHash(maze);
+    }
+    return stats;
+}
+
+bool MazeAnalytics::indexFolder(const std::string &folderPath, std::vector<IndexEntry> &entries, ThreadPool *pool,
+                                const bool symmetric) {
+    PROFILE_SCOPE("index folder");
+    entries.clear();
+    if (!std::filesystem::is_directory(folderPath)) {
+        std::cerr << "Error: " << folderPath << " is not a folder" << std::endl;
+        return false;
+    }
+    const std::string indexPath = (std::filesystem::path(folderPath) / INDEX_NAME).string();
+    std::vector<IndexEntry> previous;
+    if (std::filesystem::exists(indexPath)) {
+        loadIndex(indexPath, previous); //a bad one just means everything gets read again
+    }
+    std::ranges::sort(previous, {}, &IndexEntry::fileName);
+
+    //anything new, resized or touched since the last index gets read, the rest keep their stats.
+    //so does anything missing a canonical hash that's wanted now
+    std::unordered_map<std::string, size_t> staleSlots;
+    std::vector<std::string> staleFiles;
+    for (const std::string& path : MazePrefetcher::listFolder(folderPath)) {
+        std::error_code error;
+        IndexEntry entry;
+        entry.fileName = std::filesystem::path(path).filename().string();
+        entry.fileSize = std::filesystem::file_size(path, error);
+        entry.modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        const auto found = std::ranges::lower_bound(previous, entry.fileName, {}, &IndexEntry::fileName);
+        if (found != previous.end() && found->fileName == entry.fileName && found->fileSize == entry.fileSize &&
+            found->modified == entry.modified && (!symmetric || found->stats.canonicalHash != 0)) {
+            entry.stats = found->stats;
+        }
+        else {
+            staleSlots.emplace(path, entries.size());
+            staleFiles.push_back(path);
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    if (!staleFiles.empty()) {
+        std::vector<bool> analysed(entries.size(), true);
+        for (const auto& [path, slot] : staleSlots) {
+            analysed[slot] = false;
+        }
+        AsyncIO io;
+        MazePrefetcher prefetcher(io, staleFiles, READ_BATCH_SIZE);
+        std::vector<Maze> batch;
+        std::vector<std::string> names;
+        while (prefetcher.next(batch, &names)) {
+            auto analyseOne = [&](const size_t i) {
+                entries[staleSlots.at(names[i])].stats = analyse(batch[i], symmetric);
+            };
+            if (pool) {
+                pool->parallelFor(batch.size(), analyseOne);
+            }
+            else {
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    analyseOne(i);
+                }
+            }
+            for (const std::string& name : names) {
+                analysed[staleSlots.at(name)] = true;
+            }
+        }
+        //files that wouldn't read or decode were logged by the prefetcher, they stay out of the index
+        size_t index = 0;
+        std::erase_if(entries, [&](const IndexEntry&) {return !analysed[index++];});
+    }
+    std::cout << "Indexed " << entries.size() << " mazes in " << folderPath << " (" << staleFiles.size()
+              << " read, the rest from " << INDEX_NAME << ")" << std::endl;
+    //only rewritten if something changed, a folder nobody touched is read only
+    return (staleFiles.empty() && entries.size() == previous.size()) || saveIndex(indexPath, entries);
+}
+
+std::vector<std::string> MazeAnalytics::select(const std::string &folderPath, const std::vector<IndexEntry> &entries,
+                                               const Filter &filter) {
+    std::vector<std::string> files;
+    for (const IndexEntry& entry : entries) {
+        const uint32_t solution = entry.stats.difficulty.pathLength;
+        if (solution < filter.minSolution || solution > filter.maxSolution ||
+            (filter.perfectOnly && !entry.stats.isPerfect())) {
+            continue;
+        }
+        files.push_back((std::filesystem::path(folderPath) / entry.fileName).string());
+    }
+    return files;
+}
+
+bool MazeAnalytics::loadIndex(const std::string &fileName, std::vector<IndexEntry> &entries) {
+    std::ifstream file{fileName, std::ios::binary};
+    if (!file) {
+        std::cerr << "Error opening file for reading: " << fileName << std::endl;
+        return false;
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t statsSize = 0;
+    uint64_t count = 0;
+    //the stats go in raw, so a build with a different layout just rebuilds the index
+    if (!readRaw(file, magic) || !readRaw(file, version) || !readRaw(file, statsSize) || !readRaw(file, count) ||
+        magic != INDEX_MAGIC || version != INDEX_VERSION || statsSize != sizeof(MazeStats)) {
+        std::cerr << "Error: " << fileName << " is not an index this version can read" << std::endl;
+        return false;
+    }
+    std::vector<IndexEntry> loaded;
+    loaded.reserve(std::min<uint64_t>(count, 1u << 20));
+    for (uint64_t i = 0; i < count; ++i) {
+        IndexEntry entry;
+        uint32_t nameLength = 0;
+        if (!readRaw(file, nameLength) || nameLength > 4096) {
+            break;
+        }
+        entry.fileName.resize(nameLength);
+        file.read(entry.fileName.data(), nameLength);
+        if (!file || !readRaw(file, entry.fileSize) || !readRaw(file, entry.modified) || !readRaw(file, entry.stats)) {
+            break;
+        }
+        loaded.push_back(std::move(entry));
+    }
+    if (loaded.size() != count) {
+        std::cerr << "Error: index " << fileName << " is truncated" << std::endl;
+        return false;
+    }
+    entries = std::move(loaded);
+    return true;
+}
+
+bool MazeAnalytics::saveIndex(const std::string &fileName, const std::vector<IndexEntry> &entries) {
+    std::vector<char> buffer;
+    buffer.reserve(32 + entries.size() * (32 + sizeof(IndexEntry)));
+    appendRaw(buffer, INDEX_MAGIC);
+    appendRaw(buffer, INDEX_VERSION);
+    appendRaw(buffer, static_cast<uint32_t>(sizeof(MazeStats)));
+    appendRaw(buffer, static_cast<uint64_t>(entries.size()));
+    for (const IndexEntry& entry : entries) {
+        appendRaw(buffer, static_cast<uint32_t>(entry.fileName.size()));
+        buffer.insert(buffer.end(), entry.fileName.begin(), entry.fileName.end());
+        appendRaw(buffer, entry.fileSize);
+        appendRaw(buffer, entry.modified);
+        appendRaw(buffer, entry.stats);
+    }
+    //tmp + rename, a crash mid write leaves the old index rather than half of one
+    return CheckpointWriter::writeAtomic(fileName, buffer);
+}
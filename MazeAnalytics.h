@@ -0,0 +1,87 @@
+#ifndef MAZEANALYTICS_H
+#define MAZEANALYTICS_H
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Curriculum.h"
+#include "Maze.h"
+
+class ThreadPool;
+
+/*
+ * structural stats for a maze, so a dataset can be described and filtered without anyone looking at it.
+ * the structure is one row major sweep over the wall bytes: each cell's own bits give its degree, and its
+ * east/south openings feed two union-finds, one over every passage (connected + loop count, i.e. is it a perfect
+ * maze) and one over passages between plain corridor cells (corridor lengths).
+ * on top of that the solution length is the curriculum's bfs (so the difficulty comes along for free), and the cells
+ * get hashed once. the canonical hash turns the maze 7 ways, a full size copy each, which dwarfs everything else on
+ * a big maze, so it's only worked out when asked for.
+ * a folder's stats live in a small sidecar index next to the .mz files, keyed on name, size and mtime, so
+ * refreshing it only reads files that changed and filtering a training set only reads the index
+ */
+
+struct MazeStats {
+    static constexpr size_t CORRIDOR_BUCKETS = 16;
+
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t deadEnds{0}; //one way out
+    uint32_t junctions{0}; //three or four ways out
+    uint32_t components{0}; //connected pieces, 1 for a proper maze
+    uint32_t loops{0}; //passages on top of a spanning tree, 0 for a proper maze
+    float riverFactor{0.0f}; //share of cells that are plain corridor (two ways out), dfs mazes run ~0.9
+    std::array<uint32_t, CORRIDOR_BUCKETS> corridors{}; //corridor runs by length, bucket i is [2^i, 2^(i+1)) cells
+    MazeDifficulty difficulty; //solution length (pathLength) and the rest of what the curriculum sorts on
+    uint64_t hash{0}; //MazeHash of the cells, equal hashes are the same maze
+    uint64_t canonicalHash{0}; //same but rotations and reflections count as one maze, 0 if it wasn't asked for
+
+    [[nodiscard]] bool isPerfect() const {return components == 1 && loops == 0;}
+};
+
+class MazeAnalytics {
+public:
+    struct IndexEntry {
+        std::string fileName; //just the name, the index sits in the same folder
+        uint64_t fileSize{0};
+        int64_t modified{0}; //file clock ticks, only ever compared for equality
+        MazeStats stats;
+    };
+    struct Filter {
+        uint32_t minSolution{0};
+        uint32_t maxSolution{UINT32_MAX};
+        bool perfectOnly{false};
+    };
+
+    //symmetric also works out the canonical hash
+    static MazeStats analyse(const Maze& maze, bool symmetric = false);
+
+    //brings the folder's index up to date (only reading mazes that are new or changed, over the pool if there
+    //is one), saves it and returns it sorted by file name. false if the folder couldn't be read.
+    //symmetric also rereads indexed mazes that don't have a canonical hash yet
+    static bool indexFolder(const std::string& folderPath, std::vector<IndexEntry>& entries, ThreadPool* pool = nullptr,
+                            bool symmetric = false);
+    //full paths of the indexed mazes that pass the filter, in index order
+    static std::vector<std::string> select(const std::string& folderPath, const std::vector<IndexEntry>& entries,
+                                           const Filter& filter);
+
+    static bool loadIndex(const std::string& fileName, std::vector<IndexEntry>& entries);
+    static bool saveIndex(const std::string& fileName, const std::vector<IndexEntry>& entries);
+
+    static constexpr const char* INDEX_NAME = "index.mzi";
+
+private:
+    static constexpr uint32_t INDEX_MAGIC = 0x58495A4D; //"MZIX" in the file
+    static constexpr uint32_t INDEX_VERSION = 2;
+    static constexpr size_t READ_BATCH_SIZE = 64;
+
+    static constexpr uint8_t WALL_N = 1 << 0;
+    static constexpr uint8_t WALL_S = 1 << 1;
+    static constexpr uint8_t WALL_E = 1 << 2;
+    static constexpr uint8_t WALL_W = 1 << 3;
+};
+
+
+
+#endif //MAZEANALYTICS_H
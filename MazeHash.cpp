@@ -0,0 +1,111 @@
+#include "MazeHash.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <tuple>
+
+#include "Profiler.h"
+#include "Random.h"
+
+namespace {
+    constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr size_t LANES = 4;
+
+    uint64_t load64(const uint8_t* bytes) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    uint64_t mixLane(const uint64_t lane, const uint64_t word) {
+        return std::rotl(lane + word * PRIME_2, 31) * PRIME_1;
+    }
+}
+
+uint64_t MazeHash::hashCells(const uint8_t *cells, const size_t size, const size_t width, const size_t height) {
+    return hashBytes(cells, size, RandomStream::mix(width * PRIME_1 ^ height));
+}
+
+uint64_t MazeHash::hashBytes(const uint8_t *data, const size_t size, const uint64_t seed) {
+    std::array<uint64_t, LANES> lanes = {seed + PRIME_1, seed ^ PRIME_2, seed, seed - PRIME_1};
+    //32 bytes a round, one word per lane. the lanes don't depend on each other so the multiplies overlap
+    size_t offset = 0;
+    for (; offset + LANES * 8 <= size; offset += LANES * 8) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            lanes[lane] = mixLane(lanes[lane], load64(data + offset + lane * 8));
+        }
+    }
+    //whatever's left, zero padded out to whole words. the length goes in at the end so padding can't collide
+    std::array<uint8_t, LANES * 8> tail{};
+    if (size > offset) {
+        std::memcpy(tail.data(), data + offset, size - offset);
+    }
+    for (size_t lane = 0; lane * 8 < size - offset; ++lane) {
+        lanes[lane] = mixLane(lanes[lane], load64(tail.data() + lane * 8));
+    }
+    uint64_t result = size;
+    for (const uint64_t lane : lanes) {
+        result = RandomStream::mix(result ^ lane);
+    }
+    return result;
+}
+
+uint64_t MazeHash::hash(const Maze &maze) {
+    return hashCells(maze.cells.data(), maze.cells.size(), maze.width, maze.height);
+}
+
+uint64_t MazeHash::canonicalHash(const Maze &maze) {
+    PROFILE_SCOPE("canonical hash");
+    uint64_t best = hash(maze);
+    const size_t width = maze.width;
+    const size_t height = maze.height;
+    if (maze.cells.size() != width * height) {
+        return best; //not a grid we can turn, just compare it as it is
+    }
+    std::vector<uint8_t> turned(maze.cells.size());
+    //symmetry bits: 1 transposes, 2 flips x, 4 flips y (applied in that order). 0 is the maze itself
+    for (int symmetry = 1; symmetry < 8; ++symmetry) {
+        const bool transpose = symmetry & 1;
+        const bool flipX = symmetry & 2;
+        const bool flipY = symmetry & 4;
+        //where each wall bit ends up, worked out once per symmetry rather than per cell
+        std::array<uint8_t, 16> walls{};
+        for (uint8_t bits = 0; bits < 16; ++bits) {
+            uint8_t n = bits & WALL_N, s = bits & WALL_S, e = bits & WALL_E, w = bits & WALL_W;
+            if (transpose) {
+                //north becomes west and east becomes south
+                std::tie(n, s, e, w) = std::make_tuple(w ? WALL_N : 0, e ? WALL_S : 0, s ? WALL_E : 0, n ? WALL_W : 0);
+            }
+            if (flipX) {
+                std::tie(e, w) = std::make_tuple(w ? WALL_E : 0, e ? WALL_W : 0);
+            }
+            if (flipY) {
+                std::tie(n, s) = std::make_tuple(s ? WALL_N : 0, n ? WALL_S : 0);
+            }
+            walls[bits] = n | s | e | w;
+        }
+        const size_t turnedWidth = transpose ? height : width;
+        const size_t turnedHeight = transpose ? width : height;
+        for (size_t y = 0; y < turnedHeight; ++y) {
+            const size_t fromY = flipY ? turnedHeight - 1 - y : y;
+            for (size_t x = 0; x < turnedWidth; ++x) {
+                const size_t fromX = flipX ? turnedWidth - 1 - x : x;
+                const size_t source = transpose ? fromX * width + fromY : fromY * width + fromX;
+                const uint8_t cell = maze.cells[source];
+                turned[y * turnedWidth + x] = static_cast<uint8_t>((cell & 0xF0) | walls[cell & 0x0F]);
+            }
+        }
+        best = std::min(best, hashCells(turned.data(), turned.size(), turnedWidth, turnedHeight));
+    }
+    return best;
+}
+
+size_t MazeHash::removeDuplicates(std::vector<Maze> &mazes, const bool symmetric) {
+    PROFILE_SCOPE("remove duplicates");
+    MazeSet seen(symmetric);
+    const size_t before = mazes.size();
+    std::erase_if(mazes, [&](const Maze& maze) {return !seen.insert(maze);});
+    return before - mazes.size();
+}
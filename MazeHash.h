@@ -0,0 +1,57 @@
+#ifndef MAZEHASH_H
+#define MAZEHASH_H
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "Maze.h"
+
+/*
+ * 64 bit content hashes of mazes, for throwing out duplicates before they cost anything.
+ * small mazes repeat a lot (a 5x5 set of a few hundred has plenty of the same maze twice) and every copy in a
+ * training set is another rollout per chromosome per generation for no extra signal.
+ * the hash runs four independent multiply/rotate lanes over the wall bytes 8 at a time, so it's bound by
+ * memory rather than by one long dependency chain, and the size goes into the seed so a 4x8 and an 8x4 maze
+ * with the same bytes don't collide. canonicalHash is the smallest hash over the 8 rotations/reflections of
+ * the grid, for when mirrored copies should count as the same maze too.
+ * 64 bits means a false duplicate is around a 1 in 10^8 chance even at a million mazes, fine for a dataset
+ */
+
+class MazeHash {
+public:
+    static uint64_t hash(const Maze& maze);
+    static uint64_t canonicalHash(const Maze& maze);
+
+    //drops every maze that hashes the same as one before it, order otherwise kept. returns how many went
+    static size_t removeDuplicates(std::vector<Maze>& mazes, bool symmetric = false);
+    //the same hash over any bytes, e.g. a compiled action table
+    static uint64_t hashBytes(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+private:
+    static uint64_t hashCells(const uint8_t* cells, size_t size, size_t width, size_t height);
+
+    static constexpr uint8_t WALL_N = 1 << 0;
+    static constexpr uint8_t WALL_S = 1 << 1;
+    static constexpr uint8_t WALL_E = 1 << 2;
+    static constexpr uint8_t WALL_W = 1 << 3;
+};
+
+//hashes seen so far, for deduplicating mazes as they're generated rather than after
+class MazeSet {
+public:
+    explicit MazeSet(const bool symmetric = false) : symmetric(symmetric) {}
+
+    //true if the maze wasn't in the set yet
+    bool insert(const Maze& maze) {
+        return seen.insert(symmetric ? MazeHash::canonicalHash(maze) : MazeHash::hash(maze)).second;
+    }
+    [[nodiscard]] size_t size() const {return seen.size();}
+
+private:
+    bool symmetric;
+    std::unordered_set<uint64_t> seen; //already well mixed, std::hash passing them through is fine
+};
+
+
+
+#endif //MAZEHASH_H
@@ -0,0 +1,63 @@
+#include "MazeIO.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+std::vector<uint8_t> MazeIO::encode(const Maze &maze) {
+    std::vector<uint8_t> out;
+    encode(maze, out);
+    return out;
+}
+
+void MazeIO::encode(const Maze &maze, std::vector<uint8_t> &out) {
+    out.resize(HEADER_SIZE + maze.cells.size());
+    std::memcpy(out.data(), &maze.width, sizeof(size_t));
+    std::memcpy(out.data() + sizeof(size_t), &maze.height, sizeof(size_t));
+    std::memcpy(out.data() + HEADER_SIZE, maze.cells.data(), maze.cells.size());
+}
+
+bool MazeIO::decode(const uint8_t *data, const size_t size, Maze &maze) {
+    if (size < HEADER_SIZE) {
+        return false;
+    }
+    size_t width = 0;
+    size_t height = 0;
+    std::memcpy(&width, data, sizeof(size_t));
+    std::memcpy(&height, data + sizeof(size_t), sizeof(size_t));
+    //checked by division so a garbage header can't overflow into a size that happens to match
+    if (width == 0 || height == 0 || (size - HEADER_SIZE) / width != height || (size - HEADER_SIZE) % width != 0) {
+        return false;
+    }
+    maze.width = width;
+    maze.height = height;
+    maze.cells.assign(data + HEADER_SIZE, data + size);
+    return true;
+}
+
+bool MazeIO::readFile(const std::string &fileName, Maze &maze) {
+    std::ifstream file{fileName, std::ios::binary | std::ios::ate};
+    if (!file) {
+        std::cerr << "Error opening file for reading: " << fileName << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file || !decode(bytes.data(), bytes.size(), maze)) {
+        std::cerr << "Error: " << fileName << " is not a valid maze file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MazeIO::writeFile(const std::string &fileName, const Maze &maze) {
+    std::ofstream file{fileName, std::ios::binary};
+    if (!file) {
+        std::cerr << "Error opening file for writing: " << fileName << std::endl;
+        return false;
+    }
+    //write the maze to the file in binary, not human readable
+    const std::vector<uint8_t> bytes = encode(maze);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
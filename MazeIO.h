@@ -0,0 +1,31 @@
+#ifndef MAZEIO_H
+#define MAZEIO_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Generator.h"
+
+/*
+ * the .mz format in one place: width and height as size_t, then one byte of wall bits per cell.
+ * encode/decode work on memory so the async loader can read the bytes on one thread and decode on another,
+ * readFile/writeFile are the plain blocking versions for the odd single maze
+ */
+
+class MazeIO {
+public:
+    static std::vector<uint8_t> encode(const Maze& maze);
+    static void encode(const Maze& maze, std::vector<uint8_t>& out); //reuses out's buffer
+    //false (and maze untouched) if the bytes aren't a whole maze
+    static bool decode(const uint8_t* data, size_t size, Maze& maze);
+
+    static bool readFile(const std::string& fileName, Maze& maze);
+    static bool writeFile(const std::string& fileName, const Maze& maze);
+
+    static constexpr size_t HEADER_SIZE = 2 * sizeof(size_t);
+    static constexpr const char* EXTENSION = ".mz";
+};
+
+
+
+#endif //MAZEIO_H
@@ -0,0 +1,72 @@
+#include "MazePrefetcher.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "MazeIO.h"
+#include "Profiler.h"
+
+MazePrefetcher::MazePrefetcher(AsyncIO &io, std::vector<std::string> fileNames, const size_t batchSize,
+                               const size_t depth) : io(io), fileNames(std::move(fileNames)),
+                                                     batchSize(std::max<size_t>(1, batchSize)),
+                                                     depth(std::max<size_t>(1, depth)) {
+    for (size_t i = 0; i < this->depth; ++i) {
+        request();
+    }
+}
+
+bool MazePrefetcher::next(std::vector<Maze> &mazes, std::vector<std::string> *names) {
+    if (inFlight.empty()) {
+        return false;
+    }
+    std::vector<AsyncIO::ReadResult> results;
+    {
+        PROFILE_SCOPE("prefetch wait"); //how long the reads fell behind, should be ~0 once it gets going
+        results = inFlight.front().get();
+    }
+    inFlight.pop_front();
+    request(); //keep the pipeline full before spending time on decoding
+
+    mazes.clear();
+    if (names) {
+        names->clear();
+    }
+    for (auto& result : results) {
+        Maze maze;
+        if (!result.ok || !MazeIO::decode(result.data.data(), result.data.size(), maze)) {
+            std::cerr << "Failed to load maze file: " << result.fileName << std::endl;
+            continue;
+        }
+        mazes.push_back(std::move(maze));
+        if (names) {
+            names->push_back(std::move(result.fileName));
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> MazePrefetcher::listFolder(const std::string &folderPath) {
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(folderPath, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == MazeIO::EXTENSION) {
+            files.push_back(entry.path().string());
+        }
+    }
+    if (error) {
+        std::cerr << "Error reading folder " << folderPath << ": " << error.message() << std::endl;
+    }
+    std::ranges::sort(files);
+    return files;
+}
+
+void MazePrefetcher::request() {
+    if (nextFile >= fileNames.size()) {
+        return;
+    }
+    const size_t end = std::min(fileNames.size(), nextFile + batchSize);
+    std::vector<std::string> batch(fileNames.begin() + static_cast<std::ptrdiff_t>(nextFile),
+                                   fileNames.begin() + static_cast<std::ptrdiff_t>(end));
+    nextFile = end;
+    inFlight.push_back(io.readBatch(std::move(batch)));
+}
@@ -0,0 +1,41 @@
+#ifndef MAZEPREFETCHER_H
+#define MAZEPREFETCHER_H
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "AsyncIO.h"
+#include "Generator.h"
+
+/*
+ * walks a list of maze files in batches, keeping the next `depth` batches reading in the background.
+ * so while the caller decodes/solves/prepares batch k, batch k+1 is already coming off the disk and next()
+ * usually doesn't wait at all
+ */
+
+class MazePrefetcher {
+public:
+    MazePrefetcher(AsyncIO& io, std::vector<std::string> fileNames, size_t batchSize, size_t depth = 2);
+
+    //waits for the next batch, queues another read and decodes this one into mazes (names lines up with it).
+    //files that fail to read or decode are logged and left out. false once everything has been handed out
+    bool next(std::vector<Maze>& mazes, std::vector<std::string>* names = nullptr);
+
+    //every .mz file in a folder, sorted so the order doesn't depend on the filesystem
+    static std::vector<std::string> listFolder(const std::string& folderPath);
+
+private:
+    void request();
+
+    AsyncIO& io;
+    std::vector<std::string> fileNames;
+    size_t batchSize;
+    size_t depth;
+    size_t nextFile{0};
+    std::deque<std::future<std::vector<AsyncIO::ReadResult>>> inFlight;
+};
+
+
+
+#endif //MAZEPREFETCHER_H
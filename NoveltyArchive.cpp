@@ -0,0 +1,159 @@
+#include "NoveltyArchive.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "Profiler.h"
+
+NoveltyArchive::NoveltyArchive(const size_t dimensions, const size_t maxChecks) :
+    dimensions(std::max<size_t>(dimensions, 1)),
+    maxChecks(maxChecks) {
+}
+
+void NoveltyArchive::add(const float *behaviours, const size_t count) {
+    points.insert(points.end(), behaviours, behaviours + count * dimensions);
+    //a big batch goes into one tree rather than one per TAIL_SIZE of it
+    if (size() - indexed >= TAIL_SIZE) {
+        indexTail();
+    }
+}
+
+void NoveltyArchive::clear() {
+    points.clear();
+    trees.clear();
+    nodes.clear();
+    indexed = 0;
+}
+
+void NoveltyArchive::indexTail() {
+    PROFILE_SCOPE("index archive");
+    auto begin = static_cast<uint32_t>(indexed);
+    const auto end = static_cast<uint32_t>(size());
+    //swallow every tree that's no bigger than what's being built, they're the newest so their nodes are last
+    while (!trees.empty() && trees.back().end - trees.back().begin <= end - begin) {
+        begin = trees.back().begin;
+        nodes.resize(trees.back().root);
+        trees.pop_back();
+    }
+    order.resize(end);
+    std::iota(order.begin() + begin, order.end(), begin);
+    const int32_t root = build(begin, end);
+    trees.push_back({begin, end, root});
+    indexed = end;
+
+    //move the entries into leaf order, a leaf's range of order[] becomes the same range of points
+    std::vector<float> sorted(static_cast<size_t>(end - begin) * dimensions);
+    for (uint32_t i = begin; i < end; ++i) {
+        std::copy_n(points.data() + order[i] * dimensions, dimensions, sorted.data() + (i - begin) * dimensions);
+    }
+    std::ranges::copy(sorted, points.begin() + begin * dimensions);
+}
+
+int32_t NoveltyArchive::build(const uint32_t begin, const uint32_t end) {
+    const auto index = static_cast<int32_t>(nodes.size());
+    nodes.push_back({begin, end, 0, 0.0f});
+    if (end - begin <= LEAF_SIZE) {
+        return index;
+    }
+    //split across the axis the entries are most spread out on, judged off a sample since every entry on every
+    //axis was most of the build time. at the median so the tree stays balanced
+    const uint32_t stride = std::max<uint32_t>((end - begin) / SPREAD_SAMPLES, 1);
+    uint32_t axis = 0;
+    float widest = -1.0f;
+    for (uint32_t d = 0; d < dimensions; ++d) {
+        float low = std::numeric_limits<float>::max();
+        float high = std::numeric_limits<float>::lowest();
+        for (uint32_t i = begin; i < end; i += stride) {
+            const float value = points[order[i] * dimensions + d];
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+        if (high - low > widest) {
+            widest = high - low;
+            axis = d;
+        }
+    }
+    const uint32_t middle = begin + (end - begin) / 2;
+    const auto coordinate = [&](const uint32_t entry) {return points[entry * dimensions + axis];};
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                     [&](const uint32_t a, const uint32_t b) {return coordinate(a) < coordinate(b);});
+    //nodes can move while the children are built, so only write through the index afterwards
+    const float split = coordinate(order[middle]);
+    const int32_t left = build(begin, middle);
+    const int32_t right = build(middle, end);
+    nodes[index].axis = axis;
+    nodes[index].split = split;
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+float NoveltyArchive::distance(const float *a, const float *b) const {
+    float sum = 0.0f;
+    for (size_t d = 0; d < dimensions; ++d) {
+        const float diff = a[d] - b[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void NoveltyArchive::nearest(const float *query, const size_t k, std::vector<float> &distances) const {
+    distances.clear();
+    if (k == 0) {
+        return;
+    }
+    //max heap of the k closest so far, the one to beat is on top
+    const auto consider = [&](const float candidate) {
+        if (distances.size() < k) {
+            distances.push_back(candidate);
+            std::ranges::push_heap(distances);
+        }
+        else if (candidate < distances.front()) {
+            std::ranges::pop_heap(distances);
+            distances.back() = candidate;
+            std::ranges::push_heap(distances);
+        }
+    };
+    const auto full = [&] {return distances.size() == k;};
+
+    //subtrees still to look at, min heap on a lower bound of the squared distance to anything in them
+    thread_local std::vector<std::pair<float, int32_t>> pending;
+    pending.clear();
+    for (const Tree& tree : trees) {
+        pending.emplace_back(0.0f, tree.root);
+    }
+    size_t checked = 0;
+    while (!pending.empty()) {
+        std::ranges::pop_heap(pending, std::greater{});
+        auto [bound, node] = pending.back();
+        pending.pop_back();
+        //nothing left can be closer, or we've looked at enough
+        if (full() && (bound >= distances.front() || checked >= maxChecks)) {
+            break;
+        }
+        //straight down to the leaf on the query's side, leaving the far side of each split for later
+        while (nodes[node].left >= 0) {
+            const Node& current = nodes[node];
+            const float diff = query[current.axis] - current.split;
+            const float farBound = std::max(bound, diff * diff);
+            const int32_t far = diff <= 0.0f ? current.right : current.left;
+            if (!full() || farBound < distances.front()) {
+                pending.emplace_back(farBound, far);
+                std::ranges::push_heap(pending, std::greater{});
+            }
+            node = diff <= 0.0f ? current.left : current.right;
+        }
+        const Node& leaf = nodes[node];
+        for (uint32_t i = leaf.begin; i < leaf.end; ++i) {
+            consider(distance(query, points.data() + i * dimensions));
+        }
+        checked += leaf.end - leaf.begin;
+    }
+    //the tail is shorter than TAIL_SIZE, so scanning it keeps the query bounded too
+    for (size_t i = indexed; i < size(); ++i) {
+        consider(distance(query, points.data() + i * dimensions));
+    }
+    std::ranges::sort_heap(distances);
+}
@@ -0,0 +1,73 @@
+#ifndef NOVELTYARCHIVE_H
+#define NOVELTYARCHIVE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * every behaviour novelty search has kept so far, with a k nearest neighbour query over them.
+ * a behaviour is a fixed length float vector (what the GA makes of a rollout, see GeneticAlgorithms), and
+ * every chromosome scored asks for its k nearest, so a plain scan would be O(archive) per chromosome and
+ * end up costing more than the rollouts once the archive is a few hundred thousand long.
+ * entries live in a handful of kd-trees (split on the widest axis at the median, small leaves) plus a short
+ * unindexed tail. when the tail fills up it becomes a tree, merged with any trees no bigger than it, so tree
+ * sizes roughly double going back and each entry only gets rebuilt O(log n) times.
+ * the search is best bin first over all the trees at once: leaves are visited closest bound first and it stops
+ * after checking maxChecks entries, so past that many it's approximate but the cost per query stays flat.
+ * each tree's entries are stored in leaf order, so a leaf is one contiguous read.
+ * queries are const and thread safe, adding isn't
+ */
+
+class NoveltyArchive {
+public:
+    explicit NoveltyArchive(size_t dimensions, size_t maxChecks = DEFAULT_MAX_CHECKS);
+
+    //count behaviours packed one after another, dimensions floats each
+    void add(const float* behaviours, size_t count = 1);
+    void clear();
+
+    //squared distances to the k nearest entries, closest first. fewer than k if the archive is smaller
+    void nearest(const float* query, size_t k, std::vector<float>& distances) const;
+
+    [[nodiscard]] size_t size() const {return points.size() / dimensions;}
+    [[nodiscard]] size_t getDimensions() const {return dimensions;}
+    //entries looked at per query before giving up on the trees, anything at least size() makes it exact
+    void setMaxChecks(const size_t checks) {maxChecks = checks;}
+
+    static constexpr size_t DEFAULT_MAX_CHECKS = 2048;
+
+private:
+    struct Node {
+        uint32_t begin; //entries under this node
+        uint32_t end;
+        uint32_t axis;
+        float split; //left child has everything <= split on axis
+        int32_t left{-1}; //-1 for leaves
+        int32_t right{-1};
+    };
+    struct Tree {
+        uint32_t begin;
+        uint32_t end;
+        int32_t root;
+    };
+
+    void indexTail();
+    int32_t build(uint32_t begin, uint32_t end);
+    [[nodiscard]] float distance(const float* a, const float* b) const;
+
+    size_t dimensions;
+    size_t maxChecks;
+    std::vector<float> points; //trees in the order they were built (each in leaf order), then the tail
+    std::vector<Tree> trees; //oldest and biggest first
+    std::vector<Node> nodes; //each tree's nodes after the one before it's, so a merge just cuts the end off
+    std::vector<uint32_t> order; //scratch for building
+    size_t indexed{0}; //entries [0, indexed) are in trees, the rest are the tail
+
+    static constexpr uint32_t LEAF_SIZE = 16;
+    static constexpr size_t TAIL_SIZE = 1024; //tail length that gets turned into a tree
+    static constexpr uint32_t SPREAD_SAMPLES = 64; //entries looked at to pick a split axis
+};
+
+
+
+#endif //NOVELTYARCHIVE_H
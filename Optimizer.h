@@ -0,0 +1,29 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+#include <vector>
+
+#include "GeneticAlgorithms.h"
+
+/*
+ * ask/tell interface for black box optimisers over the chromosome genes.
+ * ask() hands out a generation of candidates, the caller fills in their fitness (higher is better)
+ * with whatever evaluation it likes, in parallel or not, and gives them back through tell() in the same order
+ */
+
+class Optimizer {
+public:
+    virtual ~Optimizer() = default;
+
+    virtual std::vector<Chromosome> ask() = 0;
+    //false (and nothing learned) if evaluated isn't the batch the last ask() handed out
+    virtual bool tell(const std::vector<Chromosome>& evaluated) = 0;
+    [[nodiscard]] virtual Chromosome getMean() const = 0;
+
+    //flat copy of the internal state, so checkpoints can put the optimiser back exactly
+    [[nodiscard]] virtual std::vector<double> getState() const = 0;
+    virtual bool setState(const std::vector<double>& state) = 0;
+};
+
+
+
+#endif //OPTIMIZER_H
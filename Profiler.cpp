@@ -0,0 +1,306 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef MAZE_PROFILING
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace {
+    struct TraceEvent {
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    struct ThreadBuffer {
+        uint32_t threadIndex{0};
+        const char* threadName{nullptr};
+        std::array<std::atomic<uint64_t>, Profiler::COUNTER_COUNT> counters{};
+        //only the owning thread writes, the lock is just so summary/export can read a consistent copy
+        std::mutex mutex;
+        std::vector<TraceEvent> events; //ring buffer, next is where the oldest entry gets overwritten
+        size_t next{0};
+        std::vector<Profiler::ScopeSummary> totals; //one entry per scope name, names are literals so pointers compare
+        bool inUse{false}; //false once its thread has exited, it's then waiting in Registry::spare
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> threads; //every buffer there is, in use or spare
+        //buffers of threads that exited, the next new thread takes one instead of making another. short lived
+        //threads (training workers, io threads, rebuilt pools) would otherwise add a buffer each, forever
+        std::vector<ThreadBuffer*> spare;
+        uint32_t nextThreadIndex{0};
+        //what exited threads recorded, moved out of their buffers before they get reused
+        std::array<uint64_t, Profiler::COUNTER_COUNT> retiredCounters{};
+        std::vector<Profiler::ScopeSummary> retiredTotals;
+    };
+
+    //never destroyed, threads can still be recording while static destructors run at exit
+    Registry& registry() {
+        static auto* instance = new Registry;
+        return *instance;
+    }
+
+    void mergeScope(std::vector<Profiler::ScopeSummary>& into, const Profiler::ScopeSummary& scope) {
+        const auto it = std::ranges::find(into, scope.name, &Profiler::ScopeSummary::name);
+        if (it == into.end()) {
+            into.push_back(scope);
+        }
+        else {
+            it->calls += scope.calls;
+            it->totalNs += scope.totalNs;
+            it->maxNs = std::max(it->maxNs, scope.maxNs);
+        }
+    }
+
+    ThreadBuffer* acquire() {
+        auto& reg = registry();
+        const std::lock_guard lock(reg.mutex);
+        ThreadBuffer* buffer;
+        if (!reg.spare.empty()) {
+            buffer = reg.spare.back();
+            reg.spare.pop_back();
+            //the last owner's events were kept for the trace until now, the capacity is kept for us
+            const std::lock_guard bufferLock(buffer->mutex);
+            buffer->events.clear();
+            buffer->next = 0;
+            buffer->threadName = nullptr;
+        }
+        else {
+            reg.threads.push_back(std::make_unique<ThreadBuffer>());
+            buffer = reg.threads.back().get();
+        }
+        buffer->threadIndex = reg.nextThreadIndex++; //a new track in the trace, even on a reused buffer
+        buffer->inUse = true;
+        return buffer;
+    }
+
+    void retire(ThreadBuffer* buffer) {
+        auto& reg = registry();
+        const std::lock_guard lock(reg.mutex);
+        const std::lock_guard bufferLock(buffer->mutex);
+        for (size_t i = 0; i < Profiler::COUNTER_COUNT; ++i) {
+            reg.retiredCounters[i] += buffer->counters[i].exchange(0, std::memory_order_relaxed);
+        }
+        for (const auto& scope : buffer->totals) {
+            mergeScope(reg.retiredTotals, scope);
+        }
+        buffer->totals.clear();
+        //the events stay until the buffer is reused, so a trace still shows what a finished thread did
+        buffer->inUse = false;
+        reg.spare.push_back(buffer);
+    }
+
+    thread_local ThreadBuffer* current = nullptr;
+    thread_local bool exiting = false;
+
+    //hands this thread's buffer back when the thread exits
+    struct BufferOwner {
+        ~BufferOwner() {
+            exiting = true;
+            retire(current);
+            current = nullptr;
+        }
+    };
+
+    ThreadBuffer& local() {
+        if (!current) {
+            current = acquire();
+            //something recording from a thread_local destructor after the owner went gets a buffer that's never
+            //handed back, but that's at most one per thread and only at exit
+            if (!exiting) {
+                thread_local BufferOwner owner;
+            }
+        }
+        return *current;
+    }
+
+    //allocations are counted from operator new, which can run before or inside local(), so it gets its own
+    //global counter instead of the per thread ones
+    std::atomic<uint64_t> allocationCount{0};
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    void writeEscaped(std::ostream& out, const char* text) {
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') out << '\\';
+            out << *text;
+        }
+    }
+}
+
+void Profiler::count(const Counter counter, const uint64_t amount) {
+    auto& value = local().counters[static_cast<size_t>(counter)];
+    //single writer, so a plain load/store is enough and skips the locked add
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void Profiler::record(const char* name, const uint64_t startNs, const uint64_t endNs) {
+    auto& buffer = local();
+    const uint64_t duration = endNs - startNs;
+    const std::lock_guard lock(buffer.mutex);
+    if (buffer.events.size() < TRACE_CAPACITY) {
+        buffer.events.push_back({name, startNs, duration}); //grows as it's used, most threads record a handful
+    }
+    else {
+        buffer.events[buffer.next] = {name, startNs, duration};
+        buffer.next = (buffer.next + 1) % TRACE_CAPACITY;
+    }
+    mergeScope(buffer.totals, {name, 1, duration, duration});
+}
+
+uint64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::setThreadName(const char* name) {
+    auto& buffer = local();
+    const std::lock_guard lock(buffer.mutex);
+    buffer.threadName = name;
+}
+
+Profiler::Summary Profiler::summary() {
+    Summary result;
+    auto& reg = registry();
+    const std::lock_guard registryLock(reg.mutex);
+    result.counters = reg.retiredCounters;
+    result.scopes = reg.retiredTotals;
+    for (const auto& thread : reg.threads) {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            result.counters[i] += thread->counters[i].load(std::memory_order_relaxed);
+        }
+        const std::lock_guard lock(thread->mutex);
+        for (const auto& scope : thread->totals) {
+            mergeScope(result.scopes, scope);
+        }
+    }
+    result.counters[static_cast<size_t>(Counter::Allocations)] += allocationCount.load(std::memory_order_relaxed);
+    std::ranges::sort(result.scopes, [](const ScopeSummary& a, const ScopeSummary& b) {return a.totalNs > b.totalNs;});
+    return result;
+}
+
+void Profiler::reset() {
+    auto& reg = registry();
+    const std::lock_guard registryLock(reg.mutex);
+    reg.retiredCounters = {};
+    reg.retiredTotals.clear();
+    for (const auto& thread : reg.threads) {
+        //counters are written without the lock, a bump racing the reset can survive it, which is fine here
+        for (auto& counter : thread->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        const std::lock_guard lock(thread->mutex);
+        thread->events.clear();
+        thread->next = 0;
+        thread->totals.clear();
+    }
+    allocationCount.store(0, std::memory_order_relaxed);
+}
+
+bool Profiler::writeChromeTrace(const std::string& fileName) {
+    std::ofstream file(fileName);
+    if (!file) {
+        std::cerr << "Error opening file for writing: " << fileName << std::endl;
+        return false;
+    }
+    //timestamps in the trace format are microseconds
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"GeneticMaze\"}}";
+    {
+        auto& reg = registry();
+        const std::lock_guard registryLock(reg.mutex);
+        for (const auto& thread : reg.threads) {
+            const std::lock_guard lock(thread->mutex);
+            if (!thread->inUse && thread->events.empty()) {
+                continue; //spare, nothing to show
+            }
+            file << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->threadIndex
+                 << ", \"args\": {\"name\": \"";
+            if (thread->threadName) {
+                writeEscaped(file, thread->threadName);
+            }
+            else {
+                file << "thread " << thread->threadIndex;
+            }
+            file << "\"}}";
+            //oldest first, the ring has wrapped if it's full
+            for (size_t i = 0; i < thread->events.size(); ++i) {
+                const auto& event = thread->events[(thread->next + i) % thread->events.size()];
+                file << ",\n{\"name\": \"";
+                writeEscaped(file, event.name);
+                file << "\", \"cat\": \"maze\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread->threadIndex
+                     << ", \"ts\": " << event.startNs / 1000.0 << ", \"dur\": " << event.durationNs / 1000.0 << "}";
+            }
+        }
+    }
+    const Summary totals = summary();
+    file << ",\n{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << now() / 1000.0 << ", \"args\": {";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        file << (i ? ", " : "") << "\"" << counterName(static_cast<Counter>(i)) << "\": " << totals.counters[i];
+    }
+    file << "}}\n]}\n";
+    return static_cast<bool>(file);
+}
+
+//counting replacements for the global allocator, only in profiling builds
+void* operator new(const std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](const std::size_t size) {
+    return ::operator new(size);
+}
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+#else
+
+//compiled out, the macros never call these but the gui/cli still can
+void Profiler::count(Counter, uint64_t) {}
+void Profiler::record(const char*, uint64_t, uint64_t) {}
+uint64_t Profiler::now() {return 0;}
+void Profiler::setThreadName(const char*) {}
+Profiler::Summary Profiler::summary() {return {};}
+void Profiler::reset() {}
+
+bool Profiler::writeChromeTrace(const std::string&) {
+    std::cerr << "Built without MAZE_ENABLE_PROFILING, no trace to write" << std::endl;
+    return false;
+}
+
+#endif
+
+const char* Profiler::counterName(const Counter counter) {
+    switch (counter) {
+        case Counter::NodesExpanded: return "nodes expanded";
+        case Counter::Rollouts: return "rollouts";
+        case Counter::SharedRollouts: return "shared rollouts";
+        case Counter::RolloutSteps: return "rollout steps";
+        case Counter::WallHits: return "wall hits";
+        case Counter::RepeatVisits: return "repeat visits";
+        case Counter::MazesGenerated: return "mazes generated";
+        case Counter::Allocations: return "allocations";
+        case Counter::Count: break;
+    }
+    return "?";
+}
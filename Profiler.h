@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * tiny instrumentation layer. PROFILE_SCOPE("name") times the rest of the block, PROFILE_COUNT(Counter, n) bumps
+ * a counter. each thread records into its own ring buffer (last TRACE_CAPACITY scopes, grown as it's used) plus
+ * running totals per scope name, so threads never fight over anything while recording. when a thread exits its totals
+ * go into a shared summary and its buffer is reused by the next thread, so short lived threads don't add up.
+ * everything is behind MAZE_PROFILING (cmake MAZE_ENABLE_PROFILING): without it the macros are empty and the
+ * functions below just return nothing, so the calls can stay in the hot paths for good.
+ * scopes cost a clock read and an uncontended lock, so they go around phases (a generation, a solve, a frame),
+ * per step things are counters
+ */
+
+class Profiler {
+public:
+    enum class Counter {
+        NodesExpanded, //A* pops
+        Rollouts,
+        SharedRollouts, //skipped, another chromosome makes exactly the same moves on that maze
+        RolloutSteps,
+        WallHits,
+        RepeatVisits,
+        MazesGenerated,
+        Allocations, //operator new calls, counted on every thread
+        Count
+    };
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+    struct ScopeSummary {
+        const char* name;
+        uint64_t calls;
+        uint64_t totalNs;
+        uint64_t maxNs;
+    };
+    struct Summary {
+        std::array<uint64_t, COUNTER_COUNT> counters{};
+        std::vector<ScopeSummary> scopes; //merged over threads, slowest total first
+    };
+
+#ifdef MAZE_PROFILING
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    static void count(Counter counter, uint64_t amount);
+    static void record(const char* name, uint64_t startNs, uint64_t endNs);
+    static uint64_t now(); //ns since the profiler started
+    static void setThreadName(const char* name); //label for this thread's track in the trace
+
+    [[nodiscard]] static Summary summary();
+    static void reset();
+    //chrome://tracing / ui.perfetto.dev json, one track per thread plus the counter totals
+    static bool writeChromeTrace(const std::string& fileName);
+    static const char* counterName(Counter counter);
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(const char* name) : name(name), start(now()) {}
+        ~ScopedTimer() {record(name, start, now());}
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    private:
+        const char* name;
+        uint64_t start;
+    };
+
+    static constexpr size_t TRACE_CAPACITY = 1 << 16; //per thread
+};
+
+#ifdef MAZE_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//name has to be a string literal (or outlive the program), only the pointer is stored
+#define PROFILE_SCOPE(name) const Profiler::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) Profiler::count(Profiler::Counter::counter, static_cast<uint64_t>(amount))
+#define PROFILE_THREAD_NAME(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+
+
+#endif //PROFILER_H
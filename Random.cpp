@@ -0,0 +1,80 @@
+#include "Random.h"
+#include <cmath>
+
+RandomStream::RandomStream(const uint64_t seed, const uint64_t generation, const uint64_t chromosome, const uint64_t maze) {
+    //seed and maze go into the key, generation and chromosome into the fixed half of the counter
+    const uint64_t keyBits = mix(seed ^ mix(maze + 0x632BE59BD9B4E019ull));
+    key = {static_cast<uint32_t>(keyBits), static_cast<uint32_t>(keyBits >> 32)};
+    const uint64_t streamBits = mix(generation) ^ (chromosome * 0x9E3779B97F4A7C15ull);
+    streamId = {static_cast<uint32_t>(streamBits), static_cast<uint32_t>(streamBits >> 32)};
+}
+
+RandomStream::result_type RandomStream::operator()() {
+    //a new block of 4 values every 4 calls, the block index is the low half of the counter
+    if ((position & 3) == 0) {
+        refill();
+    }
+    return block[position++ & 3];
+}
+
+float RandomStream::nextFloat() {
+    //top 24 bits fit a float mantissa exactly, so this never rounds up to 1.0
+    return static_cast<float>((*this)() >> 8) * (1.0f / 16777216.0f);
+}
+
+double RandomStream::nextDouble() {
+    const uint64_t high = (*this)() >> 5;
+    const uint64_t low = (*this)() >> 6;
+    return static_cast<double>((high << 26) | low) * (1.0 / 9007199254740992.0);
+}
+
+double RandomStream::nextGaussian() {
+    //1 - u keeps the log away from zero
+    const double u1 = 1.0 - nextDouble();
+    const double u2 = nextDouble();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+void RandomStream::discard(const uint64_t count) {
+    seek(position + count);
+}
+
+void RandomStream::seek(const uint64_t position) {
+    //counter based, so jumping anywhere is free, just regenerate the block we land in
+    this->position = position;
+    if ((position & 3) != 0) {
+        refill();
+    }
+}
+
+uint64_t RandomStream::mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+void RandomStream::refill() {
+    const uint64_t blockIndex = position >> 2;
+    std::array<uint32_t, 4> counter = {
+        static_cast<uint32_t>(blockIndex),
+        static_cast<uint32_t>(blockIndex >> 32),
+        streamId[0],
+        streamId[1]
+    };
+    std::array<uint32_t, 2> roundKey = key;
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        const uint64_t product0 = static_cast<uint64_t>(PHILOX_M0) * counter[0];
+        const uint64_t product1 = static_cast<uint64_t>(PHILOX_M1) * counter[2];
+        counter = {
+            static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ roundKey[0],
+            static_cast<uint32_t>(product1),
+            static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ roundKey[1],
+            static_cast<uint32_t>(product0)
+        };
+        roundKey[0] += PHILOX_W0;
+        roundKey[1] += PHILOX_W1;
+    }
+    block = counter;
+}
@@ -0,0 +1,55 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/*
+ * counter based rng (philox 4x32-10). there is no hidden state to share between threads, a stream is
+ * just a key plus a counter, and both come straight from (seed, generation, chromosome, maze).
+ * so the same ids always give the same numbers no matter which thread asks or in what order,
+ * which keeps parallel training and generation reproducible.
+ */
+
+class RandomStream {
+public:
+    using result_type = uint32_t;
+
+    RandomStream() : RandomStream(0) {}
+    explicit RandomStream(uint64_t seed, uint64_t generation = 0, uint64_t chromosome = 0, uint64_t maze = 0);
+
+    //satisfies UniformRandomBitGenerator so std::shuffle and the std distributions work with it
+    result_type operator()();
+    static constexpr result_type min() {return 0;}
+    static constexpr result_type max() {return std::numeric_limits<result_type>::max();}
+
+    float nextFloat(); //uniform in [0, 1)
+    double nextDouble(); //uniform in [0, 1), 53 bits
+    double nextGaussian(); //standard normal, box-muller so it's the same on every standard library
+    bool nextBool() {return (*this)() & 1u;}
+    void discard(uint64_t count);
+
+    //position in the stream, so a checkpoint can put it back exactly where it was
+    [[nodiscard]] uint64_t getPosition() const {return position;}
+    void seek(uint64_t position);
+
+    static uint64_t mix(uint64_t value); //splitmix64 finaliser, used to spread the ids over the key
+
+private:
+    void refill();
+
+    std::array<uint32_t, 2> key{};
+    std::array<uint32_t, 2> streamId{}; //upper half of the philox counter, fixed per stream
+    std::array<uint32_t, 4> block{}; //last generated block of 4 numbers
+    uint64_t position{0}; //number of 32 bit values handed out so far
+
+    static constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+    static constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+    static constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+    static constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+    static constexpr int PHILOX_ROUNDS = 10;
+};
+
+
+
+#endif //RANDOM_H
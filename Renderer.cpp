@@ -1,138 +1,218 @@
 #include "Renderer.h"
+#include <algorithm>
+#include <bit>
 #include <SFML/Graphics.hpp>
 
 
-void Renderer::renderMaze(const Maze &maze) {
-    //window.clear(sf::Color::White);
-    if (dirty) {
-        buildVertexArrays(maze);
+void Renderer::draw(const SimulationSnapshot &snapshot) {
+    const sf::Vector2u windowSize = window.getSize();
+    static const Maze EMPTY{};
+    const Maze& maze = snapshot.maze ? *snapshot.maze : EMPTY;
+    //walls and fills only when they changed, a tick where only agents moved leaves them alone
+    if (dirty || snapshot.sceneVersion != builtScene) {
+        builtScene = snapshot.sceneVersion;
+        buildMesh(maze, windowSize, thickness, cells, walls, &snapshot.shade, pool.get());
+    }
+    if (dirty || snapshot.version != builtVersion) {
         dirty = false;
+        builtVersion = snapshot.version;
+        placeAgents(maze, windowSize, snapshot.agents, agents);
     }
-    //draw the cells
+    //open cells are whatever the window was cleared to, this is just the shaded ones. agents go on top of those
     window.draw(cells);
+    window.draw(agents);
     window.draw(walls);
 }
 
-void Renderer::startAnimation(const Maze &maze, const std::vector<Movement> &steps) {
-    //set the animated maze to the original maze
-    animatedMaze.height = maze.height;
-    animatedMaze.width = maze.width;
-    animatedMaze.cells.resize(animatedMaze.height * animatedMaze.width);
-    for (int i = 0; i < animatedMaze.width * animatedMaze.height; ++i) {
-        animatedMaze.cells[i] = WALL_N | WALL_S | WALL_E | WALL_W;
+void Renderer::placeAgents(const Maze &maze, const sf::Vector2u windowSize, const std::vector<int> &cells,
+                           sf::VertexArray &quads) {
+    if (maze.width == 0 || maze.height == 0) {
+        quads.clear();
+        return;
+    }
+    //one quad per agent written over last tick's, resize only changes anything when the agent count does
+    quads.resize(cells.size() * 6);
+    const float cellWidth = static_cast<float>(windowSize.x) / maze.width;
+    const float cellHeight = static_cast<float>(windowSize.y) / maze.height;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const int x = cells[i] % static_cast<int>(maze.width);
+        const int y = cells[i] / static_cast<int>(maze.width);
+        writeQuad(&quads[i * 6], static_cast<float>(static_cast<int>(x * cellWidth)),
+                  static_cast<float>(static_cast<int>(y * cellHeight)), static_cast<float>(static_cast<int>(cellWidth)),
+                  static_cast<float>(static_cast<int>(cellHeight)), AGENT_SHADE);
     }
-    animatedSteps = steps;
-    currentStep = 0;
-    accumulator = 0;
-    buildVertexArrays(animatedMaze);
-}
-
-void Renderer::startSearchAnim(const Maze &maze, const std::vector<int> &steps) {
-    animatedMaze = maze;
-    searchPath = steps;
-    searchStep = 0;
-    searchAccumulator = 0;
-    searchFinished = false;
-
-    buildVertexArrays(animatedMaze);
-
 }
 
+template<typename Emit>
+void Renderer::scanBand(const Maze &maze, const std::vector<uint8_t> *shade, const size_t rowBegin,
+                        const size_t rowEnd, Emit &&emit) {
+    const size_t width = maze.width;
+    const size_t height = maze.height;
+    const auto cell = [&](const size_t x, const size_t y) {return maze.cells[y * width + x];};
 
-void Renderer::updateGenAnim(const float dt) {
-    //handle one step of the animation
-    accumulator += dt;
-    while (accumulator >= timePerFrame && currentStep < animatedSteps.size()) {
-        //get the current step
-        Movement movement = animatedSteps[currentStep];
-        //remove the wall in the given direction
-        Generator::removeWall(animatedMaze, movement.x, movement.y, movement.direction);
-        //increment the step
-        currentStep++;
-        accumulator -= timePerFrame;
+    //horizontal lines. a wall is there if either side says so, so shared walls only come out once.
+    //the band owns the line above each of its rows, the last band the bottom border as well
+    const size_t lineEnd = rowEnd == height ? height + 1 : rowEnd;
+    for (size_t line = rowBegin; line < lineEnd; ++line) {
+        size_t start = NO_RUN;
+        for (size_t x = 0; x <= width; ++x) {
+            const bool wall = x < width && ((line > 0 && cell(x, line - 1) & WALL_S) ||
+                                            (line < height && cell(x, line) & WALL_N));
+            if (wall && start == NO_RUN) {
+                start = x;
+            }
+            else if (!wall && start != NO_RUN) {
+                emit(Run{Run::Horizontal, 0, line, start, x});
+                start = NO_RUN;
+            }
+        }
     }
-    buildVertexArrays(animatedMaze);
 
-}
+    //vertical lines, followed down the band row by row so the reads stay in order. runs get cut at the band edge
+    std::vector<size_t> open(width + 1, NO_RUN);
+    for (size_t y = rowBegin; y < rowEnd; ++y) {
+        for (size_t line = 0; line <= width; ++line) {
+            const bool wall = (line > 0 && cell(line - 1, y) & WALL_E) || (line < width && cell(line, y) & WALL_W);
+            if (wall && open[line] == NO_RUN) {
+                open[line] = y;
+            }
+            else if (!wall && open[line] != NO_RUN) {
+                emit(Run{Run::Vertical, 0, line, open[line], y});
+                open[line] = NO_RUN;
+            }
+        }
+    }
+    for (size_t line = 0; line <= width; ++line) {
+        if (open[line] != NO_RUN) {
+            emit(Run{Run::Vertical, 0, line, open[line], rowEnd});
+        }
+    }
 
-void Renderer::updateSearchAnim(float dt) {
-    if (searchFinished) {
+    //shaded cells, same shade next to each other along a row is one quad. open cells are left to the clear
+    if (!shade) {
         return;
     }
-    searchAccumulator += dt;
-    while (searchAccumulator >= timePerFrame && searchStep < searchPath.size()) {
-        //get the current step
-        int cell = searchPath[searchStep++];
-        int x = cell % animatedMaze.width;
-        int y = cell / animatedMaze.width;
-
-        //draw an overlay on this cell to represent frontier
-        const sf::Vector2u size = window.getSize();
-        const float cellWidth = static_cast<float>(size.x) / animatedMaze.width;
-        const float cellHeight = static_cast<float>(size.y) / animatedMaze.height;
-
-        addQuad(cells, x*cellWidth, y*cellHeight,
-                static_cast<int>(cellWidth), static_cast<int>(cellHeight), 180);
-
-        searchAccumulator -= timePerFrame;
-    }
-    if (searchStep >= searchPath.size()) {
-        searchFinished = true;
+    for (size_t y = rowBegin; y < rowEnd; ++y) {
+        size_t x = 0;
+        while (x < width) {
+            const uint8_t color = (*shade)[y * width + x];
+            size_t end = x + 1;
+            while (end < width && (*shade)[y * width + end] == color) {
+                ++end;
+            }
+            if (color != Simulation::SHADE_OPEN) {
+                emit(Run{Run::Cells, color, y, x, end});
+            }
+            x = end;
+        }
     }
 }
 
-void Renderer::drawAnim() {
-    renderMaze(animatedMaze);
-}
-
-void Renderer::buildVertexArrays(const Maze &maze) {
-    dirty = false;
-    cells.clear();
-    walls.clear();
-
+void Renderer::buildMesh(const Maze &maze, const sf::Vector2u windowSize, const float thickness,
+                         sf::VertexArray &cells, sf::VertexArray &walls, const std::vector<uint8_t> *shade,
+                         ThreadPool *pool) {
     //get maze dimensions
     const size_t width = maze.width;
     const size_t height = maze.height;
-    if (width <= 0 || height <= 0) {
+    if (maze.width <= 0 || maze.height <= 0) {
+        cells.clear();
+        walls.clear();
         return;
     }
-    // cells.resize(maze.width * maze.height * 6);
-    // walls.resize(maze.width * maze.height * 6 * 4); // 4 walls per cell, 6 vertices per wall
-    //get the size of the window
-    const sf::Vector2u windowSize = window.getSize();
     //calculate the size of each cell, break window up into grid basically
     const float cellWidth = static_cast<float>(windowSize.x) / width;
     const float cellHeight = static_cast<float>(windowSize.y) / height;
+    //grid lines snap to whole pixels, work them all out once up front. plain loops, the compiler vectorises these
+    const auto wallThickness = static_cast<float>(static_cast<int>(thickness));
+    std::vector<float> columnEdge(width + 1), rowEdge(height + 1);
+    for (size_t x = 0; x <= width; ++x) {
+        columnEdge[x] = static_cast<float>(static_cast<int>(x * cellWidth));
+    }
+    for (size_t y = 0; y <= height; ++y) {
+        rowEdge[y] = static_cast<float>(static_cast<int>(y * cellHeight));
+    }
 
-    //loop through cells creating rectangles for each cell
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            const int cellNum = y * width + x;
-            //create a rectangle for the cell
-            addQuad(cells, static_cast<int>(x * cellWidth), static_cast<int>(y * cellHeight),
-                    static_cast<int>(cellWidth), static_cast<int>(cellHeight), 255);
-
-            if (maze.cells[cellNum] & WALL_N) {
-                //draw north wall
-                addQuad(walls, static_cast<int>(x * cellWidth), static_cast<int>(y * cellHeight),
-                        static_cast<int>(cellWidth), static_cast<int>(thickness), 0);
-            }
-            if (maze.cells[cellNum] & WALL_S) {
-                //draw south wall
-                addQuad(walls, static_cast<int>(x * cellWidth), static_cast<int>((y + 1) * cellHeight - thickness),
-                        static_cast<int>(cellWidth), static_cast<int>(thickness), 0);
-            }
-            if (maze.cells[cellNum] & WALL_E) {
-                //draw east wall
-                addQuad(walls, static_cast<int>((x + 1) * cellWidth - thickness), static_cast<int>(y * cellHeight),
-                        static_cast<int>(thickness), static_cast<int>(cellHeight), 0);
-            }
-            if (maze.cells[cellNum] & WALL_W) {
-                //draw west wall
-                addQuad(walls, static_cast<int>(x * cellWidth), static_cast<int>(y * cellHeight),
-                        static_cast<int>(thickness), static_cast<int>(cellHeight), 0);
+    const size_t bandCount = (height + BAND_ROWS - 1) / BAND_ROWS;
+    const bool parallel = pool && width * height >= PARALLEL_MIN_CELLS;
+    auto forEachBand = [&](const std::function<void(size_t)>& body) {
+        if (parallel) {
+            pool->parallelFor(bandCount, body);
+        }
+        else {
+            for (size_t band = 0; band < bandCount; ++band) {
+                body(band);
             }
         }
+    };
+
+    //counting pass: runs per band, so both arrays get sized exactly once and every band knows where it writes
+    std::vector<size_t> wallOffset(bandCount + 1, 0);
+    std::vector<size_t> cellOffset(bandCount + 1, 0);
+    forEachBand([&](const size_t band) {
+        size_t wallRuns = 0;
+        size_t cellRuns = 0;
+        scanBand(maze, shade, band * BAND_ROWS, std::min(height, (band + 1) * BAND_ROWS), [&](const Run& run) {
+            ++(run.kind == Run::Cells ? cellRuns : wallRuns);
+        });
+        wallOffset[band + 1] = wallRuns;
+        cellOffset[band + 1] = cellRuns;
+    });
+    for (size_t band = 0; band < bandCount; ++band) {
+        wallOffset[band + 1] += wallOffset[band];
+        cellOffset[band + 1] += cellOffset[band];
+    }
+    //resize keeps the old capacity, so rebuilding the same size maze doesn't allocate
+    cells.resize(cellOffset[bandCount] * 6);
+    walls.resize(wallOffset[bandCount] * 6);
+    //the arrays are a contiguous vector underneath, bands write disjoint ranges of it
+    sf::Vertex* cellVertices = cellOffset[bandCount] ? &cells[0] : nullptr;
+    sf::Vertex* wallVertices = wallOffset[bandCount] ? &walls[0] : nullptr;
+
+    forEachBand([&](const size_t band) {
+        sf::Vertex* cellOut = cellVertices + cellOffset[band] * 6;
+        sf::Vertex* wallOut = wallVertices + wallOffset[band] * 6;
+        scanBand(maze, shade, band * BAND_ROWS, std::min(height, (band + 1) * BAND_ROWS), [&](const Run& run) {
+            switch (run.kind) {
+                case Run::Horizontal: {
+                    //straddles the grid line, the outer border only gets the inside half
+                    const float top = rowEdge[run.line] - (run.line > 0 ? wallThickness : 0.0f);
+                    const float bottom = rowEdge[run.line] + (run.line < height ? wallThickness : 0.0f);
+                    writeQuad(wallOut, columnEdge[run.begin], top, columnEdge[run.end] - columnEdge[run.begin],
+                              bottom - top, 0);
+                    wallOut += 6;
+                    break;
+                }
+                case Run::Vertical: {
+                    const float left = columnEdge[run.line] - (run.line > 0 ? wallThickness : 0.0f);
+                    const float right = columnEdge[run.line] + (run.line < width ? wallThickness : 0.0f);
+                    writeQuad(wallOut, left, rowEdge[run.begin], right - left, rowEdge[run.end] - rowEdge[run.begin],
+                              0);
+                    wallOut += 6;
+                    break;
+                }
+                case Run::Cells:
+                    writeQuad(cellOut, columnEdge[run.begin], rowEdge[run.line],
+                              columnEdge[run.end] - columnEdge[run.begin], rowEdge[run.line + 1] - rowEdge[run.line],
+                              run.shade);
+                    cellOut += 6;
+                    break;
+            }
+        });
+    });
+}
+
+void Renderer::writeQuad(sf::Vertex *out, const float x, const float y, const float width, const float height,
+                         const uint8_t color) {
+    const sf::Color fill(color, color, color);
+    //triangle 1 then triangle 2, sharing the top right and bottom left corners
+    out[0].position = {x, y};
+    out[1].position = {x + width, y};
+    out[2].position = {x, y + height};
+    out[3].position = {x + width, y};
+    out[4].position = {x, y + height};
+    out[5].position = {x + width, y + height};
+    for (int i = 0; i < 6; ++i) {
+        out[i].color = fill;
     }
 }
 
@@ -174,30 +254,3 @@ void Renderer::addQuad(sf::VertexArray &array, float x, float y, int width, int
     // array.append(v3);
     // array.append(v4);
 }
-
-void Renderer::highlightSolution(const Maze& maze, const std::vector<int> &solution) {//solution is just a list of cell indices
-    buildVertexArrays(maze);
-
-    //get maze dimensions
-    const size_t width = maze.width;
-    const size_t height = maze.height;
-    if (width <= 0 || height <= 0) {
-        return;
-    }
-    // cells.resize(maze.width * maze.height * 6);
-    // walls.resize(maze.width * maze.height * 6 * 4); // 4 walls per cell, 6 vertices per wall
-    //get the size of the window
-    const sf::Vector2u windowSize = window.getSize();
-    //calculate the size of each cell, break window up into grid basically
-    const float cellWidth = static_cast<float>(windowSize.x) / width;
-    const float cellHeight = static_cast<float>(windowSize.y) / height;
-    //highlight cells in the maze blue for the solution, with the start and end red
-    for (const auto cell : solution) {
-        const int x = cell % maze.width;
-        const int y = cell / maze.width;
-        //create a rectangle for the cell
-        addQuad(cells, static_cast<int>(x * cellWidth), static_cast<int>(y * cellHeight),
-                    static_cast<int>(cellWidth), static_cast<int>(cellHeight), 128);
-    }
-
-}
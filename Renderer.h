@@ -4,72 +4,82 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
+#include <memory>
+
 #include "Generator.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
 
 
+//draws whatever the simulation last published, all the animation state lives in Simulation now
 class Renderer {
 public:
     explicit Renderer(sf::RenderWindow& window, const float thickness): window(window),
                                                                         thickness(thickness) {
-        // Initialize the animated maze with the same dimensions as the original maze
         cells.setPrimitiveType(sf::PrimitiveType::Triangles);
         walls.setPrimitiveType(sf::PrimitiveType::Triangles);
+        agents.setPrimitiveType(sf::PrimitiveType::Triangles);
+        //the calling thread helps out in parallelFor, so the pool needs one less
+        const unsigned threadCount = std::thread::hardware_concurrency();
+        pool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount - 1) : nullptr;
     }
 
     ~Renderer() = default;
 
-    void renderMaze(const Maze& maze);
-    void startAnimation(const Maze& maze, const std::vector<Movement>& steps);
-    void startSearchAnim(const Maze& maze, const std::vector<int>& steps);
-    void updateGenAnim(float dt);
-    void updateSearchAnim(float dt);
-    void drawAnim();
-    void setFramerateLimit(float framerate) {this->framerate = framerate; timePerFrame = 1.0f / framerate;}
-    void buildVertexArrays(const Maze& maze);
-    void addQuad(sf::VertexArray &array, float x, float y, int width, int height, uint8_t color);
-
-    [[nodiscard]] bool getAnimationFinished() const {return currentStep >= animatedSteps.size();}
-    [[nodiscard]] size_t getAnimationStep() const {return currentStep;}
-    [[nodiscard]] size_t getTotalSteps() const {return animatedSteps.size();}
-    [[nodiscard]] bool getSearchFinished() const {return searchFinished;}
-    [[nodiscard]] size_t getSearchStep() const {return searchStep;}
-    [[nodiscard]] size_t getTotalSearchSteps() const {return searchPath.size();}
-    [[nodiscard]] const std::vector<int>& getSearchPath() const {return searchPath;}
-    void setAnimatedMaze(const Maze& maze) {animatedMaze = maze;}
-    [[nodiscard]] const Maze& getAnimatedMaze() const {return animatedMaze;}
-    [[nodiscard]] const std::vector<Movement>& getAnimatedSteps() const {return animatedSteps;}
-    //functions for handling solver animation
-    void highlightSolution(const Maze& maze, const std::vector<int>& solution);
+    //rebuilds the maze mesh only when the walls/shading or the window size changed, the agents whenever the
+    //snapshot did
+    void draw(const SimulationSnapshot& snapshot);
+    //the actual mesh build, no window needed, so it can be benchmarked headless. shade is the fill per cell.
+    //walls come out as merged runs, and open cells aren't drawn at all (the window clear is the background).
+    //big mazes get split into row bands over the pool if there is one
+    static void buildMesh(const Maze& maze, sf::Vector2u size, float thickness, sf::VertexArray& cells,
+                          sf::VertexArray& walls, const std::vector<uint8_t>* shade = nullptr,
+                          ThreadPool* pool = nullptr);
+    static void addQuad(sf::VertexArray &array, float x, float y, int width, int height, uint8_t color);
+    //a quad per agent cell, rewritten in place, so a whole population costs a single draw call
+    static void placeAgents(const Maze& maze, sf::Vector2u size, const std::vector<int>& cells, sf::VertexArray& quads);
     void setDirty() {
         dirty = true;
     }
 
 private:
+    //a straight stretch of wall, or of cells with the same shade, in grid units. begin/end are cells along the
+    //line, end exclusive. a horizontal line n is the top edge of row n, a vertical one the left edge of column n
+    struct Run {
+        enum Kind : uint8_t {Horizontal, Vertical, Cells} kind;
+        uint8_t shade;
+        size_t line;
+        size_t begin;
+        size_t end;
+    };
+    //finds every run in rows [rowBegin, rowEnd) and hands it to emit, used for both the counting and the filling
+    template<typename Emit>
+    static void scanBand(const Maze& maze, const std::vector<uint8_t>* shade, size_t rowBegin, size_t rowEnd,
+                         Emit&& emit);
+
+    //writes the two triangles straight into a slot that's already sized, same layout as addQuad
+    static void writeQuad(sf::Vertex* out, float x, float y, float width, float height, uint8_t color);
+
     sf::RenderWindow& window;
-    Maze animatedMaze;
-    std::vector<Movement> animatedSteps;
 
     float thickness = 2;
     sf::VertexArray cells;
     sf::VertexArray walls;
-
-    int currentStep = 0;
-    float accumulator = 0;
-    float framerate = 60;
-    float timePerFrame = 1.0f / framerate;
-
-    //search animation
-    std::vector<int> searchPath;
-    size_t searchStep = 0;
-    float searchAccumulator = 0;
-    bool searchFinished = true;
+    sf::VertexArray agents;
+    uint64_t builtVersion = 0; //snapshot the agents were placed from
+    uint64_t builtScene = 0; //scene the walls and fills were built from
 
     static constexpr uint8_t WALL_N = 1 << 0;
     static constexpr uint8_t WALL_S = 1 << 1;
     static constexpr uint8_t WALL_E = 1 << 2;
     static constexpr uint8_t WALL_W = 1 << 3;
+    static constexpr uint8_t AGENT_SHADE = 64;
+    static constexpr size_t BAND_ROWS = 32; //rows per parallel chunk
+    static constexpr size_t NO_RUN = SIZE_MAX;
+    static constexpr size_t PARALLEL_MIN_CELLS = 1 << 14; //below this the pool handoff costs more than it saves
 
-    bool dirty = false; //set to true when the maze is changed, so we can rebuild the vertex arrays
+    bool dirty = true; //set when the window is resized, so we rebuild even if the snapshot didn't change
+    std::unique_ptr<ThreadPool> pool; //null on a single core machine
 
 
 };
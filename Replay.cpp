@@ -0,0 +1,105 @@
+#include "Replay.h"
+#include <algorithm>
+
+void Replay::clear(const size_t width) {
+    this->width = width;
+    directions.clear();
+    jumps.clear();
+    lastJump = 0;
+    count = 0;
+    current = -1;
+}
+
+void Replay::move(const uint8_t direction) {
+    current = neighbour(current, direction);
+    push(direction);
+}
+
+void Replay::jump(const int cell) {
+    const int64_t offset = static_cast<int64_t>(cell) - std::max(current, 0);
+    writeVarint(jumps, count - lastJump);
+    writeVarint(jumps, (static_cast<uint64_t>(offset) << 1) ^ static_cast<uint64_t>(offset >> 63)); //zigzag
+    lastJump = count;
+    current = cell;
+    push(0); //the slot is still there so indexes line up, the bits just aren't read
+}
+
+void Replay::moveFrom(const int from, const uint8_t direction) {
+    if (from != current) {
+        jump(from);
+    }
+    move(direction);
+}
+
+void Replay::push(const uint8_t direction) {
+    const size_t shift = (count % 4) * 2;
+    if (shift == 0) {
+        directions.push_back(0);
+    }
+    directions.back() |= static_cast<uint8_t>((direction & 0x3) << shift);
+    ++count;
+}
+
+void Replay::writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+    //7 bits at a time, high bit set means there's more
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t Replay::readVarint(const std::vector<uint8_t> &in, size_t &offset) {
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        const uint8_t byte = in[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+int Replay::neighbour(const int cell, const uint8_t direction) const {
+    switch (direction) {
+        case 0: return cell - static_cast<int>(width);
+        case 1: return cell + 1;
+        case 2: return cell + static_cast<int>(width);
+        default: return cell - 1;
+    }
+}
+
+ReplayCursor::ReplayCursor(std::shared_ptr<const Replay> replay) : replay(std::move(replay)) {
+    if (this->replay) {
+        readJump();
+    }
+}
+
+void ReplayCursor::readJump() {
+    if (jumpOffset >= replay->jumps.size()) {
+        nextJump = SIZE_MAX;
+        return;
+    }
+    const size_t previous = nextJump == SIZE_MAX ? 0 : nextJump;
+    nextJump = previous + Replay::readVarint(replay->jumps, jumpOffset);
+}
+
+Replay::Step ReplayCursor::next() {
+    Replay::Step step{};
+    step.from = current;
+    if (index == nextJump) {
+        const uint64_t zigzag = Replay::readVarint(replay->jumps, jumpOffset);
+        const auto offset = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        current = static_cast<int>(std::max(current, 0) + offset);
+        step.from = -1;
+        step.jumped = true;
+        readJump();
+    }
+    else {
+        step.direction = (replay->directions[index / 4] >> ((index % 4) * 2)) & 0x3;
+        current = replay->neighbour(current, step.direction);
+    }
+    step.cell = current;
+    ++index;
+    return step;
+}
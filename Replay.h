@@ -0,0 +1,81 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * compact record of a walk over the maze grid, what the generation animation plays back (searches aren't
+ * recorded, the simulation steps them straight out of the solver's coroutine).
+ * every step is a 2 bit direction from wherever the walk is (same order as Direction), 4 to a byte.
+ * anything that isn't a move to a neighbour (dfs backing up to an older cell) is a jump, kept in a separate byte
+ * stream as two varints: steps since the last jump and the zigzagged cell offset from where the walk was. both are
+ * usually small, so a jump is ~3 bytes not 8. a 1000x1000 carve comes out around 1MB this way instead of 12MB
+ * of Movements.
+ * written once by whoever records it, then shared read only (shared_ptr<const Replay>) and read back with a
+ * ReplayCursor, forwards only, nothing gets copied
+ */
+
+class Replay {
+public:
+    explicit Replay(size_t width = 0) : width(width) {}
+
+    struct Step {
+        int cell; //where the walk is after this step
+        int from; //where it was before, -1 for a jump
+        uint8_t direction; //from -> cell, only meaningful when it's not a jump
+        bool jumped;
+    };
+
+    void clear(size_t width); //keeps the buffers for reuse
+    void move(uint8_t direction); //step to the neighbour in that direction
+    void jump(int cell); //land on cell without walking there
+    //walks from -> neighbour in direction, with a jump first if from isn't where the walk is
+    void moveFrom(int from, uint8_t direction);
+
+    [[nodiscard]] size_t size() const {return count;}
+    [[nodiscard]] bool empty() const {return count == 0;}
+    [[nodiscard]] size_t getWidth() const {return width;}
+
+private:
+    friend class ReplayCursor;
+
+    void push(uint8_t direction);
+    [[nodiscard]] int neighbour(int cell, uint8_t direction) const;
+    static void writeVarint(std::vector<uint8_t>& out, uint64_t value);
+    static uint64_t readVarint(const std::vector<uint8_t>& in, size_t& offset);
+
+    size_t width{0};
+    std::vector<uint8_t> directions; //packed, step i is bits 2*(i%4) of byte i/4
+    std::vector<uint8_t> jumps; //varint pairs in step order
+    size_t lastJump{0}; //step index of the previous jump, what the next one is stored relative to
+    size_t count{0};
+    int current{-1}; //cell the walk is on, -1 before the first step (offsets count from 0 then)
+};
+
+//forward only reader, holds its own reference so the replay outlives whoever recorded it
+class ReplayCursor {
+public:
+    ReplayCursor() = default;
+    explicit ReplayCursor(std::shared_ptr<const Replay> replay);
+
+    [[nodiscard]] bool done() const {return !replay || index >= replay->count;}
+    Replay::Step next(); //only call when !done()
+
+    [[nodiscard]] size_t position() const {return index;} //steps taken so far
+    [[nodiscard]] size_t size() const {return replay ? replay->count : 0;}
+    [[nodiscard]] int cell() const {return current;} //-1 until the first step
+
+private:
+    void readJump(); //decodes the next jump's step index, its cell offset stays in the stream until it's used
+
+    std::shared_ptr<const Replay> replay;
+    size_t index{0};
+    size_t jumpOffset{0}; //read position in the jump stream
+    size_t nextJump{SIZE_MAX}; //step index of the next jump, SIZE_MAX once there are none left
+    int current{-1};
+};
+
+
+
+#endif //REPLAY_H
@@ -0,0 +1,208 @@
+#include "RolloutKernel.h"
+#include <algorithm>
+
+void VisitedSet::begin(const size_t cellCount) {
+    if (stamps.size() < cellCount) {
+        stamps.resize(cellCount, 0);
+    }
+    ++epoch;
+    if (epoch == 0) {
+        //wrapped after 4 billion rollouts, old stamps could look current again so wipe them once
+        std::ranges::fill(stamps, 0);
+        epoch = 1;
+    }
+}
+
+PreparedMaze RolloutKernel::prepare(const Maze &maze) {
+    PreparedMaze prepared;
+    prepared.maze = &maze;
+    prepared.width = static_cast<int>(maze.width);
+    prepared.height = static_cast<int>(maze.height);
+    //goal is bottom right
+    prepared.goalCell = static_cast<int>(maze.cells.size()) - 1;
+    prepared.goalX = prepared.width - 1;
+    prepared.goalY = prepared.height - 1;
+    prepared.featureX.resize(prepared.width);
+    prepared.featureY.resize(prepared.height);
+    for (int x = 0; x < prepared.width; ++x) {
+        prepared.featureX[x] = (prepared.goalX - x) / float(maze.width);
+    }
+    for (int y = 0; y < prepared.height; ++y) {
+        prepared.featureY[y] = (prepared.goalY - y) / float(maze.height);
+    }
+    return prepared;
+}
+
+CompiledPolicy RolloutKernel::compile(const float *genes) {
+    CompiledPolicy policy;
+    for (int i = 0; i < numOutputs; ++i) {
+        const float* row = genes + i * numInputs;
+        for (int walls = 0; walls < 16; ++walls) {
+            //accumulate in feature order so the float sums match the plain dot product exactly
+            float score = 0.0f;
+            for (int j = 0; j < 4; ++j) {
+                score += row[j] * ((walls & wallMasks[j]) ? 1.0f : 0.0f);
+            }
+            policy.wallScore[i][walls] = score;
+        }
+        policy.weightX[i] = row[4];
+        policy.weightY[i] = row[5];
+        policy.bias[i] = row[6];
+    }
+    return policy;
+}
+
+int RolloutKernel::chooseDirection(const PreparedMaze &maze, const CompiledPolicy &policy, const uint8_t walls,
+                                   const int x, const int y, RandomStream &rng) {
+    const float fx = maze.featureX[x];
+    const float fy = maze.featureY[y];
+    // find the direction with the highest score
+    int best = 0;
+    float bestScore = score(policy, 0, walls, fx, fy);
+    for (int i = 1; i < numOutputs; ++i) {
+        const float next = score(policy, i, walls, fx, fy);
+        //ties are broken by coin flip, the stream is only touched when there actually is a tie
+        if (next > bestScore || (next == bestScore && rng.nextBool())) {
+            bestScore = next;
+            best = i;
+        }
+    }
+    return best;
+}
+
+bool RolloutKernel::move(const PreparedMaze &maze, RolloutState &state, VisitedSet &visited, const uint8_t walls,
+                         const int direction) {
+    state.steps++;
+
+    //move to new cell based on direction unless blocked (waste step)
+    const int neighborX = state.x + dx[direction];
+    const int neighborY = state.y + dy[direction];
+    if (neighborX < 0 || neighborX >= maze.width || neighborY < 0 || neighborY >= maze.height ||
+        (walls & wallMasks[direction])) {
+        state.wallCollisions++;
+        return true;
+    }
+    const int neighborCell = state.cell + dx[direction] + dy[direction] * maze.width;
+    //penalize repeat visit
+    if (visited.test(neighborCell)) {
+        state.repeats++;
+        return true;
+    }
+    state.x = neighborX;
+    state.y = neighborY;
+    state.cell = neighborCell;
+    visited.set(neighborCell);
+    if (neighborCell == maze.goalCell) {
+        state.reachedGoal = true;
+        return false;
+    }
+    return true;
+}
+
+bool RolloutKernel::advance(const PreparedMaze &maze, const CompiledPolicy &policy, RolloutState &state,
+                            VisitedSet &visited, RandomStream &rng) {
+    const uint8_t walls = maze.maze->cells[state.cell] & 0x0F;
+    return move(maze, state, visited, walls, chooseDirection(maze, policy, walls, state.x, state.y, rng));
+}
+
+bool RolloutKernel::step(const PreparedMaze &maze, const CompiledPolicy &policy, RolloutState &state,
+                         VisitedSet &visited, RandomStream &rng) {
+    if (state.reachedGoal) {
+        return false;
+    }
+    return advance(maze, policy, state, visited, rng);
+}
+
+RolloutState RolloutKernel::run(const PreparedMaze &maze, const CompiledPolicy &policy, RandomStream &rng,
+                                const int maxSteps, RolloutTrace *trace) {
+    thread_local VisitedSet visited;
+    visited.begin(maze.maze->cells.size());
+
+    RolloutState state; //start at the top left
+    visited.set(state.cell);
+    if (trace) {
+        //separate loop so the untraced one stays as tight as it was
+        bool going = true;
+        while (going && state.steps < maxSteps) {
+            going = advance(maze, policy, state, visited, rng);
+            record(maze, state, *trace);
+        }
+        return state;
+    }
+    while (state.steps < maxSteps && advance(maze, policy, state, visited, rng)) {
+    }
+    return state;
+}
+
+size_t RolloutKernel::tableSize(const PreparedMaze &maze) {
+    const size_t cellCount = maze.maze->cells.size();
+    return (cellCount + 3) / 4 + (cellCount + 7) / 8;
+}
+
+bool RolloutKernel::buildTable(const PreparedMaze &maze, const CompiledPolicy &policy, uint8_t *table) {
+    const size_t cellCount = maze.maze->cells.size();
+    uint8_t* moves = table;
+    uint8_t* ties = table + (cellCount + 3) / 4;
+    std::fill_n(table, tableSize(maze), 0);
+    const auto width = static_cast<size_t>(maze.width);
+    //a row at a time: scores and picks into flat arrays first, no branches, so the compiler can vectorise it,
+    //then packed down to bits
+    thread_local std::vector<uint8_t> rowMoves;
+    thread_local std::vector<uint8_t> rowTies;
+    rowMoves.resize(width);
+    rowTies.resize(width);
+    uint8_t anyTie = 0;
+    for (int y = 0; y < maze.height; ++y) {
+        const float fy = maze.featureY[y];
+        const uint8_t* walls = maze.maze->cells.data() + y * width;
+        for (size_t x = 0; x < width; ++x) {
+            const uint8_t wall = walls[x] & 0x0F;
+            const float fx = maze.featureX[x];
+            //same comparisons as chooseDirection. a score equal to the best so far is where that would flip a
+            //coin, so the cell is flagged even if something later beats both
+            float bestScore = score(policy, 0, wall, fx, fy);
+            uint8_t best = 0;
+            uint8_t tie = 0;
+            for (int i = 1; i < numOutputs; ++i) {
+                const float next = score(policy, i, wall, fx, fy);
+                tie |= next == bestScore;
+                best = next > bestScore ? static_cast<uint8_t>(i) : best;
+                bestScore = next > bestScore ? next : bestScore;
+            }
+            rowMoves[x] = best;
+            rowTies[x] = tie;
+        }
+        for (size_t x = 0; x < width; ++x) {
+            const size_t cell = y * width + x;
+            moves[cell >> 2] |= rowMoves[x] << ((cell & 3) * 2);
+            ties[cell >> 3] |= rowTies[x] << (cell & 7);
+            anyTie |= rowTies[x];
+        }
+    }
+    return anyTie != 0;
+}
+
+RolloutState RolloutKernel::runTable(const PreparedMaze &maze, const uint8_t *table, const CompiledPolicy &policy,
+                                     RandomStream &rng, const int maxSteps, RolloutTrace *trace) {
+    thread_local VisitedSet visited;
+    visited.begin(maze.maze->cells.size());
+    const uint8_t* ties = table + (maze.maze->cells.size() + 3) / 4;
+
+    RolloutState state; //start at the top left
+    visited.set(state.cell);
+    while (state.steps < maxSteps) {
+        const int cell = state.cell;
+        const uint8_t walls = maze.maze->cells[cell] & 0x0F;
+        const int direction = (ties[cell >> 3] >> (cell & 7)) & 1
+                                  ? chooseDirection(maze, policy, walls, state.x, state.y, rng)
+                                  : (table[cell >> 2] >> ((cell & 3) * 2)) & 3;
+        const bool going = move(maze, state, visited, walls, direction);
+        if (trace) {
+            record(maze, state, *trace);
+        }
+        if (!going) {
+            break;
+        }
+    }
+    return state;
+}
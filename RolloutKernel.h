@@ -0,0 +1,123 @@
+#ifndef ROLLOUTKERNEL_H
+#define ROLLOUTKERNEL_H
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Generator.h"
+#include "Random.h"
+
+/*
+ * the inner loop of GA training: walk one policy through one maze.
+ * everything that doesn't change per step is worked out up front (per maze constants, per chromosome
+ * wall scores), x/y are tracked instead of divided out of the cell index, and the visited set is a
+ * reused per thread buffer with epoch stamps so a rollout never allocates or clears anything.
+ * the scores are summed in the same order as the plain dot product, so moves don't change.
+ * a policy only looks at the cell's walls and where the goal is, so on a given maze its move out of every
+ * cell is fixed. for small mazes that gets compiled into an action table (2 bits a cell) and the rollout
+ * just walks the table. cells where scores tie are flagged and still go through chooseDirection, which flips
+ * the same coins from the same stream, so a table rollout comes out exactly like a scored one
+ */
+
+//per maze constants, built once when the mazes are loaded
+struct PreparedMaze {
+    const Maze* maze{nullptr};
+    int width{0};
+    int height{0};
+    int goalX{0};
+    int goalY{0};
+    int goalCell{0};
+    std::vector<float> featureX; //(goalX - x) / width for every column
+    std::vector<float> featureY; //(goalY - y) / height for every row
+};
+
+//genes rearranged for the step loop, the wall part of each score is looked up by the raw wall byte
+struct CompiledPolicy {
+    std::array<std::array<float, 16>, 4> wallScore{}; //[direction][walls] = sum of the 4 wall weights
+    std::array<float, 4> weightX{};
+    std::array<float, 4> weightY{};
+    std::array<float, 4> bias{};
+};
+
+struct RolloutState {
+    int x{0};
+    int y{0};
+    int cell{0};
+    int steps{0};
+    int wallCollisions{0};
+    int repeats{0};
+    bool reachedGoal{false};
+};
+
+//where a rollout spent its steps, on a coarse grid laid over the maze. only filled in when asked for
+struct RolloutTrace {
+    static constexpr int SIDE = 4;
+    std::array<uint32_t, SIDE * SIDE> visits{}; //steps that ended in each region, row major
+};
+
+//epoch stamped visited set, clearing is just bumping the epoch
+class VisitedSet {
+public:
+    void begin(size_t cellCount);
+    [[nodiscard]] bool test(const int cell) const {return stamps[cell] == epoch;}
+    void set(const int cell) {stamps[cell] = epoch;}
+
+private:
+    std::vector<uint32_t> stamps;
+    uint32_t epoch{0};
+};
+
+class RolloutKernel {
+public:
+    static PreparedMaze prepare(const Maze& maze);
+    static CompiledPolicy compile(const float* genes);
+
+    //whole rollout from the start cell, uses this thread's visited buffer. trace, if given, should start zeroed
+    static RolloutState run(const PreparedMaze& maze, const CompiledPolicy& policy, RandomStream& rng, int maxSteps,
+                            RolloutTrace* trace = nullptr);
+
+    //action table layout: the move for every cell, 4 cells a byte, then a tie bit per cell, 8 a byte
+    static size_t tableSize(const PreparedMaze& maze);
+    //fills table (tableSize bytes) with the policy's move out of every cell. returns whether any cell ties
+    static bool buildTable(const PreparedMaze& maze, const CompiledPolicy& policy, uint8_t* table);
+    //same rollout as run, moves come out of the table and policy is only scored on tie cells
+    static RolloutState runTable(const PreparedMaze& maze, const uint8_t* table, const CompiledPolicy& policy,
+                                 RandomStream& rng, int maxSteps, RolloutTrace* trace = nullptr);
+    //one step, for callers that drive many agents themselves. returns false once the goal is reached
+    static bool step(const PreparedMaze& maze, const CompiledPolicy& policy, RolloutState& state,
+                     VisitedSet& visited, RandomStream& rng);
+    static int chooseDirection(const PreparedMaze& maze, const CompiledPolicy& policy, uint8_t walls, int x, int y,
+                               RandomStream& rng);
+
+    static constexpr int numInputs = 7; //same layout as GeneticAlgorithms, 4 walls + 2 goal offsets + bias
+    static constexpr int numOutputs = 4;
+
+private:
+    static bool advance(const PreparedMaze& maze, const CompiledPolicy& policy, RolloutState& state,
+                        VisitedSet& visited, RandomStream& rng);
+    //takes the step once the direction is picked, false once the goal is reached
+    static bool move(const PreparedMaze& maze, RolloutState& state, VisitedSet& visited, uint8_t walls, int direction);
+    static void record(const PreparedMaze& maze, const RolloutState& state, RolloutTrace& trace) {
+        ++trace.visits[state.y * RolloutTrace::SIDE / maze.height * RolloutTrace::SIDE +
+                       state.x * RolloutTrace::SIDE / maze.width];
+    }
+    //one direction's score. everything that picks a move goes through this so they all round the same way
+    static float score(const CompiledPolicy& policy, const int direction, const uint8_t walls, const float fx,
+                       const float fy) {
+        return policy.wallScore[direction][walls] + policy.weightX[direction] * fx + policy.weightY[direction] * fy +
+               policy.bias[direction] * 1.0f;
+    }
+
+    static constexpr int dx[4] = {  0, +1,  0, -1 };
+    static constexpr int dy[4] = { -1,  0, +1,  0 };
+    static constexpr uint8_t WALL_N = 1 << 0;
+    static constexpr uint8_t WALL_S = 1 << 1;
+    static constexpr uint8_t WALL_E = 1 << 2;
+    static constexpr uint8_t WALL_W = 1 << 3;
+    //feature order is N, E, S, W to match the direction enum
+    static constexpr uint8_t wallMasks[4] = {WALL_N, WALL_E, WALL_S, WALL_W};
+};
+
+
+
+#endif //ROLLOUTKERNEL_H
@@ -0,0 +1,77 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/*
+ * a lazy sequence of values from a coroutine: the body co_yields one value at a time and only runs when the
+ * caller asks for the next. the coroutine's state (locals, the search frontier, whatever) lives in its frame
+ * until it finishes or the Sequence is dropped, so a search can be stepped from the simulation thread a few
+ * expansions a tick and nobody has to keep a log of what it did.
+ * move only, one reader. std::generator would do the same but isn't in every standard library we build with
+ */
+
+template <typename T>
+class Sequence {
+public:
+    struct promise_type {
+        T current{};
+        std::exception_ptr error;
+
+        Sequence get_return_object() {return Sequence{std::coroutine_handle<promise_type>::from_promise(*this)};}
+        std::suspend_always initial_suspend() noexcept {return {};} //nothing runs until the first next()
+        std::suspend_always final_suspend() noexcept {return {};}
+        std::suspend_always yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {error = std::current_exception();}
+    };
+
+    Sequence() = default;
+    Sequence(Sequence&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Sequence& operator=(Sequence&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Sequence(const Sequence&) = delete;
+    Sequence& operator=(const Sequence&) = delete;
+    ~Sequence() {reset();}
+
+    //runs the body up to its next co_yield. false once it's finished (or there's no body), value() is then stale.
+    //anything the body throws comes out of here
+    bool next() {
+        if (!handle || handle.done()) {
+            return false;
+        }
+        handle.resume();
+        if (handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, {}));
+        }
+        return !handle.done();
+    }
+    [[nodiscard]] const T& value() const {return handle.promise().current;}
+    [[nodiscard]] bool valid() const {return static_cast<bool>(handle);}
+
+    //drops the coroutine and everything in its frame, whether it finished or not
+    void reset() {
+        if (handle) {
+            handle.destroy();
+            handle = {};
+        }
+    }
+
+private:
+    explicit Sequence(const std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+
+#endif //SEQUENCE_H
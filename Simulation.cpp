@@ -0,0 +1,272 @@
+#include "Simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Profiler.h"
+
+Simulation::Simulation() : worker([this] {run();}) {
+}
+
+Simulation::~Simulation() {
+    {
+        const std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void Simulation::showMaze(MazeHandle maze) {
+    submit({.mode = SimulationMode::Static, .maze = std::move(maze)});
+}
+
+void Simulation::showSolution(MazeHandle maze, const std::vector<int> &solution) {
+    submit({.mode = SimulationMode::Static, .maze = std::move(maze), .solution = solution});
+}
+
+void Simulation::startGeneration(MazeHandle maze, std::shared_ptr<const Replay> carving) {
+    submit({.mode = SimulationMode::Generation, .maze = std::move(maze), .replay = std::move(carving)});
+}
+
+void Simulation::startSearch(MazeHandle maze, Sequence<SearchStep> steps) {
+    submit({.mode = SimulationMode::Search, .maze = std::move(maze), .search = std::move(steps)});
+}
+
+void Simulation::startPopulation(MazeHandle maze, std::vector<CompiledPolicy> policies, const int maxSteps,
+                                 const uint64_t seed) {
+    submit({.mode = SimulationMode::Population, .maze = std::move(maze), .policies = std::move(policies),
+            .maxSteps = maxSteps, .seed = seed});
+}
+
+void Simulation::setStepRate(const float stepsPerSecond) {
+    stepRate = std::max(stepsPerSecond, 0.1f);
+}
+
+void Simulation::setPaused(const bool paused) {
+    this->paused = paused;
+    wake.notify_all();
+}
+
+const SimulationSnapshot &Simulation::latest() {
+    snapshots.update();
+    return snapshots.read();
+}
+
+void Simulation::submit(Command command) {
+    //set here rather than on the thread so the gui sees it straight away
+    animating = command.mode != SimulationMode::Static;
+    {
+        const std::lock_guard lock(mutex);
+        pending = std::move(command); //anything not picked up yet is replaced, only the newest matters
+    }
+    wake.notify_all();
+}
+
+void Simulation::run() {
+    PROFILE_THREAD_NAME("simulation");
+    using Clock = std::chrono::steady_clock;
+    auto last = Clock::now();
+    double owed = 0.0; //steps due but not taken yet, the fractional part carries over between ticks
+
+    std::unique_lock lock(mutex);
+    while (true) {
+        auto ready = [this] {return stopping || pending || (active() && !paused);};
+        if (!ready()) {
+            //nothing to step, sleep until a command or unpause. time spent here doesn't count towards steps
+            wake.wait(lock, ready);
+            last = Clock::now();
+            owed = 0.0;
+        }
+        if (stopping) {
+            return;
+        }
+        if (pending) {
+            Command command = std::move(*pending);
+            pending.reset();
+            lock.unlock();
+            apply(command);
+            publish();
+            lock.lock();
+            last = Clock::now();
+            owed = 0.0;
+            continue;
+        }
+
+        //fixed timestep: every step is 1/rate seconds of simulated time, however the ticks fall
+        const double rate = stepRate.load();
+        lock.unlock();
+        const auto now = Clock::now();
+        owed += std::chrono::duration<double>(now - last).count() * rate;
+        last = now;
+        if (owed >= 1.0) {
+            PROFILE_SCOPE("simulation tick");
+            const auto steps = static_cast<size_t>(owed);
+            owed -= static_cast<double>(steps);
+            for (size_t i = 0; i < steps && active(); ++i) {
+                step();
+            }
+            if (!active()) {
+                owed = 0.0;
+                animating = false;
+            }
+            publish();
+        }
+        lock.lock();
+
+        //sleep until the next step is due. at least 1ms so fast rates take several steps per tick instead of
+        //spinning, at most 50ms so a new rate or pause gets noticed quickly even at 1 step a second
+        const double wait = std::clamp((1.0 - owed) / rate, 0.001, 0.05);
+        wake.wait_for(lock, std::chrono::duration<double>(wait), [this] {return stopping || pending.has_value();});
+    }
+}
+
+void Simulation::apply(Command &command) {
+    mode = command.maze ? command.mode : SimulationMode::Static; //nothing to animate without a maze
+    maze = std::move(command.maze);
+    cursor = ReplayCursor(std::move(command.replay));
+    solution = std::move(command.solution);
+    search = std::move(command.search); //drops whatever search was still running
+    searchStep = 0;
+    searchCell = -1;
+    searchDone = !search.valid();
+    const size_t cellCount = maze ? maze->cells.size() : 0;
+    shade.assign(cellCount, SHADE_OPEN);
+    ++sceneVersion;
+    agents.clear();
+    liveAgents = 0;
+
+    if (mode == SimulationMode::Generation) {
+        //the moves knock walls down, so start with every wall up
+        carving.width = maze->width;
+        carving.height = maze->height;
+        carving.cells.assign(cellCount, ALL_WALLS);
+    }
+    else if (mode == SimulationMode::Population) {
+        startAgents(std::move(command.policies), command.maxSteps, command.seed);
+    }
+    else if (mode == SimulationMode::Static) {
+        for (const int cell : solution) {
+            shade[cell] = SHADE_SOLUTION;
+        }
+    }
+    animating = active();
+}
+
+void Simulation::startAgents(std::vector<CompiledPolicy> policies, const int maxSteps, const uint64_t seed) {
+    const size_t cellCount = std::max<size_t>(maze->cells.size(), 1);
+    const size_t limit = std::max<size_t>(PLAYBACK_STAMP_BUDGET / cellCount, 1);
+    if (policies.size() > limit) {
+        std::cerr << "Maze too big to play back " << policies.size() << " agents, showing the first " << limit
+                  << std::endl;
+        policies.resize(limit);
+    }
+    this->policies = std::move(policies);
+    prepared = RolloutKernel::prepare(*maze); //points into the maze, which the handle keeps alive
+    const size_t count = this->policies.size();
+    agents.assign(count, RolloutState{});
+    agentVisited.resize(count);
+    agentStreams.clear();
+    for (size_t i = 0; i < count; ++i) {
+        //same start as a training rollout, the top left already counts as visited
+        agentVisited[i].begin(maze->cells.size());
+        agentVisited[i].set(0);
+        agentStreams.emplace_back(seed, 0, i, PLAYBACK_STREAM);
+    }
+    agentStep = 0;
+    agentMaxSteps = static_cast<size_t>(std::max(maxSteps, 0));
+    liveAgents = count;
+}
+
+void Simulation::step() {
+    if (mode == SimulationMode::Generation) {
+        //jumps are just the carve backing up, skip past them so every step knocks a wall down
+        Replay::Step step = cursor.next();
+        while (step.jumped && !cursor.done()) {
+            step = cursor.next();
+        }
+        if (!step.jumped) {
+            Generator::removeWall(carving, step.from % static_cast<int>(carving.width),
+                                  step.from / static_cast<int>(carving.width), step.direction);
+        }
+    }
+    else if (mode == SimulationMode::Search) {
+        //the search only runs as far as it's been shown. it ends by handing out the path it found, which goes on
+        //top of everything it looked at
+        if (!search.next()) {
+            searchDone = true;
+            search.reset();
+            return;
+        }
+        const SearchStep& step = search.value();
+        shade[step.cell] = step.solution ? SHADE_SOLUTION : SHADE_SEARCHED;
+        searchCell = step.cell;
+        ++searchStep;
+    }
+    else if (mode == SimulationMode::Population) {
+        //one move for everyone still walking, the walls and shading stay as they are
+        for (size_t i = 0; i < agents.size(); ++i) {
+            if (!agents[i].reachedGoal &&
+                !RolloutKernel::step(prepared, policies[i], agents[i], agentVisited[i], agentStreams[i])) {
+                --liveAgents;
+            }
+        }
+        ++agentStep;
+        return;
+    }
+    ++sceneVersion;
+}
+
+bool Simulation::active() const {
+    if (mode == SimulationMode::Population) {
+        return liveAgents > 0 && agentStep < agentMaxSteps;
+    }
+    if (mode == SimulationMode::Search) {
+        return !searchDone;
+    }
+    return mode != SimulationMode::Static && !cursor.done();
+}
+
+void Simulation::publish() {
+    //assigning into the recycled slot reuses its buffers, so a publish doesn't allocate once sizes settle
+    SimulationSnapshot &snapshot = snapshots.writeBuffer();
+    snapshot.version = ++version;
+    if (mode == SimulationMode::Generation) {
+        //the slot's maze is only shared if it last held someone else's, then rewrite starts a new one
+        Maze& out = snapshot.maze.rewrite();
+        out.width = carving.width;
+        out.height = carving.height;
+        out.cells = carving.cells;
+    }
+    else {
+        snapshot.maze = maze; //nothing changes the walls, just share them
+    }
+    //a slot that already holds this scene (agents moving, nothing else) keeps its copy of the shading
+    if (snapshot.sceneVersion != sceneVersion) {
+        snapshot.shade = shade;
+        snapshot.sceneVersion = sceneVersion;
+    }
+    snapshot.agents.clear();
+    if (mode == SimulationMode::Search && searchCell >= 0 && active()) {
+        snapshot.agents.push_back(searchCell); //search frontier
+    }
+    for (const RolloutState& agent : agents) {
+        snapshot.agents.push_back(agent.cell);
+    }
+    snapshot.arrived = agents.size() - liveAgents;
+    snapshot.mode = mode;
+    if (mode == SimulationMode::Population) {
+        snapshot.step = agentStep;
+        snapshot.totalSteps = agentMaxSteps;
+    }
+    else if (mode == SimulationMode::Search) {
+        snapshot.step = searchStep;
+        snapshot.totalSteps = searchDone ? searchStep : 0;
+    }
+    else {
+        snapshot.step = cursor.position();
+        snapshot.totalSteps = cursor.size();
+    }
+    snapshot.finished = !active();
+    snapshots.publish();
+}
@@ -0,0 +1,143 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "Generator.h"
+#include "Replay.h"
+#include "RolloutKernel.h"
+#include "SolverAgent.h"
+#include "TripleBuffer.h"
+
+/*
+ * steps the animations (maze carving, search order, agent playback) on its own thread at a fixed rate that has
+ * nothing to do with the frame rate, anywhere from 1 to hundreds of thousands of steps a second.
+ * after each tick it publishes a full snapshot through a triple buffer, the render thread draws whichever
+ * snapshot is newest and never waits on the simulation (or the other way round).
+ * commands from the gui are latest wins, same as the checkpoint writer.
+ * replays and mazes are shared, not copied, the cursor streams straight out of what the generator recorded
+ * and a static or search snapshot points at the generator's maze. a search isn't recorded at all, its steps are
+ * pulled out of the solver's coroutine as they're shown, so only the frontier is ever held. only the carve animation has a maze of its
+ * own, since its walls change every step.
+ * population playback walks every chromosome through the maze together with the training kernel's step, one
+ * move each per step. the walls and shading don't change while they walk, so the snapshot's sceneVersion stays
+ * put and the renderer only rewrites the agent quads
+ */
+
+enum class SimulationMode {
+    Static, //just showing a maze, nothing to step
+    Generation, //carving the walls out move by move
+    Search, //visiting cells in search order, then showing the solution
+    Population //every chromosome in the population walking the maze at once
+};
+
+//everything the renderer needs for one frame, immutable once published
+struct SimulationSnapshot {
+    uint64_t version{0}; //bumped every publish, the renderer only rebuilds when it changes
+    uint64_t sceneVersion{0}; //bumped when the walls or shading change, agents moving on their own don't
+    MazeHandle maze; //wall bits as of this step, empty before the first command
+    std::vector<uint8_t> shade; //fill per cell, 255 = open
+    std::vector<int> agents; //cells with an agent on them, drawn on top
+    size_t arrived{0}; //population playback, agents that made it to the goal
+    SimulationMode mode{SimulationMode::Static};
+    size_t step{0};
+    size_t totalSteps{0}; //0 when it isn't known up front, a search only knows once it's done
+    bool finished{true};
+};
+
+class Simulation {
+public:
+    Simulation();
+    ~Simulation();
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void showMaze(MazeHandle maze);
+    void showSolution(MazeHandle maze, const std::vector<int>& solution);
+    //only the size is taken from maze, the walls come from carving
+    void startGeneration(MazeHandle maze, std::shared_ptr<const Replay> carving);
+    //steps from one of the solver's searches, run on the simulation thread a step at a time as they're shown
+    void startSearch(MazeHandle maze, Sequence<SearchStep> steps);
+    //one agent per policy, all starting top left and heading for the bottom right, maxSteps moves at most.
+    //ties are broken off (seed, agent) streams so a replay of the same population plays out the same
+    void startPopulation(MazeHandle maze, std::vector<CompiledPolicy> policies, int maxSteps, uint64_t seed = 0);
+
+    void setStepRate(float stepsPerSecond);
+    void setPaused(bool paused);
+    [[nodiscard]] bool isAnimating() const {return animating;}
+
+    //render thread only: picks up the newest snapshot if there is one and returns it
+    const SimulationSnapshot& latest();
+
+    static constexpr uint8_t SHADE_OPEN = 255;
+    static constexpr uint8_t SHADE_SEARCHED = 180;
+    static constexpr uint8_t SHADE_SOLUTION = 128;
+
+private:
+    struct Command {
+        SimulationMode mode{SimulationMode::Static};
+        MazeHandle maze;
+        std::shared_ptr<const Replay> replay;
+        std::vector<int> solution;
+        std::vector<CompiledPolicy> policies;
+        int maxSteps{0};
+        uint64_t seed{0};
+        Sequence<SearchStep> search;
+    };
+
+    void submit(Command command);
+    void run();
+    void apply(Command& command);
+    void startAgents(std::vector<CompiledPolicy> policies, int maxSteps, uint64_t seed);
+    void step();
+    void publish();
+    [[nodiscard]] bool active() const;
+
+    static constexpr uint8_t ALL_WALLS = 0x0F; //N | S | E | W, how a cell starts before carving
+    //every agent has its own visited stamps (one per cell), so big mazes get fewer agents rather than gigabytes
+    static constexpr size_t PLAYBACK_STAMP_BUDGET = 1 << 24;
+    static constexpr uint64_t PLAYBACK_STREAM = 0x504C4159; //keeps the tie breaks apart from training's streams
+
+    //simulation thread state
+    SimulationMode mode{SimulationMode::Static};
+    MazeHandle maze;
+    Maze carving; //the walls so far while generating, copied into each snapshot
+    std::vector<uint8_t> shade;
+    ReplayCursor cursor;
+    std::vector<int> solution;
+    //search animation, the coroutine holds the search's state
+    Sequence<SearchStep> search;
+    size_t searchStep{0};
+    int searchCell{-1};
+    bool searchDone{true};
+    //population playback, one of each per agent
+    PreparedMaze prepared;
+    std::vector<CompiledPolicy> policies;
+    std::vector<RolloutState> agents;
+    std::vector<VisitedSet> agentVisited;
+    std::vector<RandomStream> agentStreams;
+    size_t agentStep{0};
+    size_t agentMaxSteps{0};
+    size_t liveAgents{0};
+    uint64_t version{0};
+    uint64_t sceneVersion{0};
+
+    TripleBuffer<SimulationSnapshot> snapshots;
+
+    std::mutex mutex;
+    std::condition_variable wake; //new command, rate change, unpause or shutdown
+    std::optional<Command> pending;
+    std::atomic<float> stepRate{60.0f};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> animating{false};
+    bool stopping{false};
+    std::thread worker; //last, the thread uses everything above
+};
+
+
+
+#endif //SIMULATION_H
@@ -1,12 +1,12 @@
 
 #include "SolverAgent.h"
+#include "Profiler.h"
 #include <algorithm>
 #include <fstream>
 #include <iostream>
 
-SolverAgent::SolverAgent(Maze& maze) {
-    this->maze = &maze;
-    rebuild(maze);
+SolverAgent::SolverAgent(MazeHandle maze) {
+    rebuild(std::move(maze));
 
 }
 
@@ -20,105 +20,114 @@ float SolverAgent::calculateHeuristic(const int x, const int y) const {
 }
 
 void SolverAgent::solve() {
+    PROFILE_SCOPE("astar solve");
     //reset/clear all data
     reset();
-    // Implement the A* algorithm to solve the maze
-    // Initialize the open set with the starting position
-    const int startCellID = startY * maze->width + startX;
-    const int goalCellID = goalY * maze->width + goalX;
+    drain(searchSteps());
+}
 
-    gScore[startCellID] = 0;
-    fScore[startCellID] = calculateHeuristic(startX, startY);
+Sequence<SearchStep> SolverAgent::searchSteps() const {
+    return aStar(maze, startY * static_cast<int>(maze->width) + startX, goalY * static_cast<int>(maze->width) + goalX);
+}
 
-    open_set.push({startCellID, fScore[startCellID]});
-    static constexpr int wallMasks[4] = {
-        WALL_N,
-        WALL_E,
-        WALL_S,
-        WALL_W
+Sequence<SearchStep> SolverAgent::aStar(const MazeHandle maze, const int start, const int goal) {
+    // Implement the A* algorithm to solve the maze
+    //everything here lives in the coroutine frame between steps: a byte per cell (closed + the move that got
+    //there, which is all the path needs) and the frontier. g and f ride along in the queue entries
+    const int width = static_cast<int>(maze->width);
+    const int height = static_cast<int>(maze->height);
+    const int goalX = goal % width;
+    const int goalY = goal / width;
+    struct Entry {
+        uint64_t key; //f << 32 | ~g, smallest f first and the deepest of those, so ties head for the goal
+        int32_t cell;
+        int32_t g;
+        uint8_t direction;
     };
-    // Main loop of the A* algorithm
-    while (!open_set.empty()) {
-        auto current = open_set.top();
-        open_set.pop();
-        const int currentCellID = current.cellID;
-        const int currentX = currentCellID % maze->width;
-        const int currentY = currentCellID / maze->width;
+    const auto later = [](const Entry& lhs, const Entry& rhs) {return lhs.key > rhs.key;};
+    std::vector<uint8_t> marks(maze->cells.size(), 0);
+    std::vector<Entry> open; //this is the frontier, i.e., leading edge of search
+    const auto push = [&](const int cell, const int g, const uint8_t direction) {
+        const int f = g + std::abs(cell % width - goalX) + std::abs(cell / width - goalY);
+        open.push_back({static_cast<uint64_t>(f) << 32 | static_cast<uint32_t>(~g), cell, g, direction});
+        std::ranges::push_heap(open, later);
+    };
+    push(start, 0, 0);
 
-        //check if already visited somehow
-        if (closedSet[currentCellID]) {
+    // Main loop of the A* algorithm
+    while (!open.empty()) {
+        std::ranges::pop_heap(open, later);
+        const Entry current = open.back();
+        open.pop_back();
+        //check if already visited somehow, cheaper copies get popped first so this one's stale
+        if (marks[current.cell] & CLOSED) {
             continue;
         }
-
-        closedSet[currentCellID] = true;
-        path.push_back(currentCellID);
+        marks[current.cell] = CLOSED | current.direction;
+        PROFILE_COUNT(NodesExpanded, 1);
+        co_yield SearchStep{current.cell, false};
 
         // Check if we reached the goal
-        if (currentCellID == goalCellID) {
-            // Reconstruct the path from the goal to the start
-            int cell = currentCellID;
-            while (cell != startCellID) {
-                solution.push_back(cell);
-                cell = parents[cell];
+        if (current.cell == goal) {
+            // Reconstruct the path from the goal to the start, backing out of each cell the way it came in
+            std::vector<int> path{goal};
+            int cell = goal;
+            while (cell != start) {
+                const int direction = marks[cell] & 0x3;
+                cell -= dx[direction] + dy[direction] * width;
+                path.push_back(cell);
+            }
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                co_yield SearchStep{*it, true};
             }
-            solution.push_back(startCellID); // Add the start cell to the solution
-            std::ranges::reverse(solution);
-            return;
+            co_return;
         }
 
         //check neighbors
+        const int currentX = current.cell % width;
+        const int currentY = current.cell / width;
         for (int direction = 0; direction < 4; direction++) {
-            auto neighborX = currentX + dx[direction];
-            auto neighborY = currentY + dy[direction];
-
+            const int neighborX = currentX + dx[direction];
+            const int neighborY = currentY + dy[direction];
             //check if the neighbor is out of bounds
-            if (neighborX < 0 || neighborX >= maze->width || neighborY < 0 || neighborY >= maze->height) {
+            if (neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height) {
                 continue;
             }
-            const int neighborCellID = neighborY * maze->width + neighborX;
-
             //check for wall between neighbor and current with wall mask
-            if (maze->cells[currentCellID] & wallMasks[direction]) {
+            if (maze->cells[current.cell] & wallMasks[direction]) {
                 continue;
             }
-
-            //check if the neighbor is already in the closed set
-            if (closedSet[neighborCellID]) {
-                continue;
-            }
-            // Calculate the tentative gScore for the neighbor
-            float tentative_gScore = gScore[currentCellID] + 1; //assuming uniform cost for each step
-            // If the neighbor is not in the open set or the new gScore is better
-            if (tentative_gScore < gScore[neighborCellID]) {
-                // This path to the neighbor is better than any previous one
-                parents[neighborCellID] = currentCellID;
-                gScore[neighborCellID] = tentative_gScore;
-                fScore[neighborCellID] = gScore[neighborCellID] + calculateHeuristic(neighborX, neighborY);
-
-                open_set.push({neighborCellID, fScore[neighborCellID]});
+            const int neighborCell = neighborY * width + neighborX;
+            if (!(marks[neighborCell] & CLOSED)) {
+                push(neighborCell, current.g + 1, static_cast<uint8_t>(direction)); //uniform cost for each step
             }
         }
     }
+}
+
+void SolverAgent::drain(Sequence<SearchStep> steps) {
+    while (steps.next()) {
+        const SearchStep& step = steps.value();
+        if (step.solution) {
+            solution.push_back(step.cell);
+        }
+        else {
+            ++visited;
+        }
     }
+}
 
-void SolverAgent::rebuild(Maze &maze) {
+void SolverAgent::rebuild(MazeHandle maze) {
     //re-init all data when maze is generated at a new size
-    this->maze = &maze;
-    // Initialize the closed set with the size of the maze
-    closedSet.resize(maze.width * maze.height, false);
-    // Initialize the fScore and gScore vectors with the size of the maze
-    // Set the initial fScore and gScore to infinity, since we want smallest distance/score
-    fScore.resize(maze.width * maze.height, std::numeric_limits<float>::max());
-    gScore.resize(maze.width * maze.height, std::numeric_limits<float>::max());
-
-    //init the parent cell vector
-    parents.resize(maze.width * maze.height, -1);
+    this->maze = std::move(maze);
+    const Maze& current = *this->maze;
+    //search state lives in each search now, so there's nothing to size here
 
     // Set the starting position and goal position
     startX = 0;
     startY = 0;
-    goalX = static_cast<int>(maze.width) - 1;
-    goalY = static_cast<int>(maze.height) - 1;
+    goalX = static_cast<int>(current.width) - 1;
+    goalY = static_cast<int>(current.height) - 1;
 
 }
 
@@ -133,16 +142,7 @@ void SolverAgent::printSolution() const {
 
 void SolverAgent::reset() {
     // Reset solver state for a fresh run
-    std::ranges::fill(closedSet, false);
-    std::ranges::fill(gScore,   std::numeric_limits<float>::max());
-    std::ranges::fill(fScore,   std::numeric_limits<float>::max());
-    std::ranges::fill(parents,  -1);
-
-    // clear out any old nodes still in the priority queue
-    while (!open_set.empty()) open_set.pop();
-
-    // now clear your output paths
-    path.clear();
+    visited = 0;
     solution.clear();
 }
 
@@ -176,61 +176,53 @@ void SolverAgent::loadGenes(const std::string& genesFile) {
 }
 
 void SolverAgent::solveGenetic() {
+    PROFILE_SCOPE("genetic solve");
     //reset/clear all data
     reset();
-    // Implement the A* algorithm to solve the maze
-    // Initialize the open set with the starting position
-    const int startCellID = startY * maze->width + startX;
-    const int goalCellID = goalY * maze->width + goalX;
-
+    drain(agentSteps());
+}
 
-    static constexpr int wallMasks[4] = {
-        WALL_N,
-        WALL_E,
-        WALL_S,
-        WALL_W
-    };
-    //check for genes first
+Sequence<SearchStep> SolverAgent::agentSteps() const {
+    //check for genes first, without any the walk is empty
     if (genes.empty()) {
         std::cerr << "Error: no genes loaded" << std::endl;
-        return;
     }
+    const int width = static_cast<int>(maze->width);
+    return agentWalk(maze, genes, seed, startY * width + startX, goalY * width + goalX);
+}
 
-    int currentCellID = startCellID;
-    path.clear();
-    solution.clear();
-    path.push_back(currentCellID);
+Sequence<SearchStep> SolverAgent::agentWalk(const MazeHandle maze, const std::vector<float> genes, const uint64_t seed,
+                                            const int start, const int goal) {
+    if (genes.empty()) {
+        co_return;
+    }
+    const int width = static_cast<int>(maze->width);
+    const int height = static_cast<int>(maze->height);
+    int currentCellID = start;
+    co_yield SearchStep{currentCellID, false};
+    //the walk is the solution if it makes it to the goal, so keep it as we go. at most max steps long
+    std::vector<int> walk{currentCellID};
 
     //solve maze using genetic algorithm
-    int feature_size = GeneticAlgorithms::getNumInputs();
-    std::vector<float> features{};
-    features.resize(feature_size);
+    const int feature_size = GeneticAlgorithms::getNumInputs();
+    const int numOutputs = GeneticAlgorithms::getNumOutputs();
+    std::vector<float> features(feature_size);
+    std::vector<float> outputs(numOutputs);
 
     int steps = 0;
+    RandomStream rng(seed); //tie-break stream, restarted every run
 
     //run until hits goal or max steps
-    while (steps < GeneticAlgorithms::getMaxSteps() && currentCellID != goalCellID) {
+    while (steps < GeneticAlgorithms::getMaxSteps() && currentCellID != goal) {
         //initialize the features with the wall masks and distances and stuff
-        int walls = maze->cells[currentCellID];
+        const int walls = maze->cells[currentCellID];
         for (int direction = 0; direction < 4; ++direction) {
-            if (walls & wallMasks[direction]) {
-                features[direction] = 1.0f; //wall present
-            }
-            else {
-                features[direction] = 0.0f; //no wall
-            }
+            features[direction] = (walls & wallMasks[direction]) ? 1.0f : 0.0f; //wall present or not
         }
-        int goalX = goalCellID % maze->width;
-        int goalY = goalCellID / maze->width;
-        features[4] = (goalX - currentCellID % maze->width) / static_cast<float>(maze->width);
-        features[5] = (goalY - currentCellID / maze->width) / static_cast<float>(maze->height);
+        features[4] = (goal % width - currentCellID % width) / static_cast<float>(width);
+        features[5] = (goal / width - currentCellID / width) / static_cast<float>(height);
         features[6] = 1.0f; //bias term
 
-
-        std::vector<float> outputs{};
-        const int numOutputs = GeneticAlgorithms::getNumOutputs();
-        outputs.resize(numOutputs);
-
         for (int i = 0; i < numOutputs; ++i) {
             float score = 0;
             for (int j = 0; j < feature_size; ++j) {
@@ -243,39 +235,26 @@ void SolverAgent::solveGenetic() {
         int best = 0;
         float bestScore = outputs[0];
         for (int i = 1; i < numOutputs; ++i) {
-            if (outputs[i] > bestScore || (outputs[i] == bestScore && std::rand() % 2)) {
+            if (outputs[i] > bestScore || (outputs[i] == bestScore && rng.nextBool())) {
                 bestScore = outputs[i];
                 best = i;
             }
         }
-        //check for neighbor out of bounds
-        const int neighborX = currentCellID % maze->width + dx[best];
-        const int neighborY = currentCellID / maze->width + dy[best];
-        if (neighborX < 0 || neighborX >= maze->width || neighborY < 0 || neighborY >= maze->height) {
-            //out of bounds, waste step
-            steps++;
-            continue;
-        }
-        //if direction is blocked, waste step
-        if (maze->cells[currentCellID] & wallMasks[best]) {
-            //blocked, waste step
-            steps++;
+        steps++;
+        //out of bounds or blocked by a wall, waste step
+        const int neighborX = currentCellID % width + dx[best];
+        const int neighborY = currentCellID / width + dy[best];
+        if (neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height ||
+            (walls & wallMasks[best])) {
             continue;
         }
-        //add to path
-
-
-        currentCellID = neighborY * maze->width + neighborX; //move to new cell
-        path.push_back(currentCellID);
-
-        //increment the step
-        steps++;
-        std::cout << steps << std::endl;
-        //check if we reached the goal
-        if (currentCellID == goalCellID) {
-            solution = path;
+        currentCellID = neighborY * width + neighborX; //move to new cell
+        walk.push_back(currentCellID);
+        co_yield SearchStep{currentCellID, false};
+    }
+    if (currentCellID == goal) {
+        for (const int cell : walk) {
+            co_yield SearchStep{cell, true};
         }
-
     }
 }
-
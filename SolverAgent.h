@@ -1,33 +1,30 @@
 #ifndef SOLVERAGENT_H
 #define SOLVERAGENT_H
-#include <queue>
+#include <memory>
 #include <vector>
 #include "Generator.h"
 #include "GeneticAlgorithms.h"
+#include "Sequence.h"
 
 /* * SolverAgent.h
  *
  *  this class handles the solving of the maze, using a solver agent
  *  for now just using A* algo, maybe add more later if required
+ *  both solvers are coroutines that hand out one step at a time, solve() and solveGenetic() just run them to
+ *  the end. the search animation pulls steps straight out of one as it draws, so a search on a huge maze starts
+ *  showing right away and nothing keeps a log of every cell it looked at
  *
  */
 
-//basic data struct to order queue
-struct Cell {
-    int cellID;
-    float f_score;
-};
-
-//This compares f score values to order the priority queue
-struct CompareFScore {
-    bool operator() (const Cell& lhs, const Cell& rhs) const {
-        return lhs.f_score > rhs.f_score; //order by smallest f
-    }
+//one thing a search did: looked at a cell, or once it's done, a cell on the path it found (start first)
+struct SearchStep {
+    int cell{0};
+    bool solution{false};
 };
 
 class SolverAgent {
 public:
-    explicit SolverAgent(Maze& maze);
+    explicit SolverAgent(MazeHandle maze);
     [[nodiscard]] float calculateHeuristic(int x, int y) const; //manhattan distance
     void solve();
 
@@ -40,7 +37,8 @@ public:
         goalY = y;
     }
 
-    void rebuild(Maze& maze);
+    //holds on to the maze it's given, a new version from the generator needs another rebuild to be seen
+    void rebuild(MazeHandle maze);
 
     void printSolution() const;
     void reset();
@@ -48,24 +46,27 @@ public:
     [[nodiscard]] const std::vector<int> &getSolution() const {
         return solution;
     }
-    [[nodiscard]] const std::vector<int> &getPath() const {
-        return path;
-    }
-    [[nodiscard]] const std::vector<int> &getParents() const {
-        return parents;
-    }
-    [[nodiscard]] const std::vector<bool> &getClosedSet() const {
-        return closedSet;
-    }
+    [[nodiscard]] size_t getVisitedCount() const {return visited;} //cells the last solve looked at
+
+    //the same searches as a lazy sequence of steps, from the current start/goal (and genes). they hold their own
+    //reference to the maze and copies of everything else, so they can be run on another thread
+    [[nodiscard]] Sequence<SearchStep> searchSteps() const;
+    [[nodiscard]] Sequence<SearchStep> agentSteps() const;
 
     void loadGenes(const std::string& genesFile);
     void solveGenetic();
+    void setSeed(const uint64_t seed) {this->seed = seed;} //seed for the agent's tie-break stream
 
 
 
 
 private:
-    Maze* maze;
+    static Sequence<SearchStep> aStar(MazeHandle maze, int start, int goal);
+    static Sequence<SearchStep> agentWalk(MazeHandle maze, std::vector<float> genes, uint64_t seed, int start,
+                                          int goal);
+    void drain(Sequence<SearchStep> steps); //runs a search to the end, keeping the solution and the count
+
+    MazeHandle maze; //shared with the generator, never copied
     //starting position
     int startX{0};
     int startY{0};
@@ -73,17 +74,9 @@ private:
     int goalX{0};
     int goalY{0};
 
-    std::vector<float> fScore; //F = G + H
-    std::vector<float> gScore; //number of steps to get to this cell
-
-
-    std::priority_queue<Cell, std::vector<Cell>, CompareFScore> open_set; //this is the frontier, i.e., leading edge of search
-    std::vector<bool> closedSet; //track visited
-
     //list cell id's for a solution path when completed
     std::vector<int> solution; //this is just the cells for the solution in correct order
-    std::vector<int> path; //this is the full step-by-step search path
-    std::vector<int> parents; //step back through this to find the solution path
+    size_t visited{0};
 
     // direction arrays
     //   0 = Up    (north)
@@ -98,9 +91,12 @@ private:
     static constexpr uint8_t WALL_S = 1 << 1;
     static constexpr uint8_t WALL_E = 1 << 2;
     static constexpr uint8_t WALL_W = 1 << 3;
+    static constexpr uint8_t wallMasks[4] = {WALL_N, WALL_E, WALL_S, WALL_W};
+    static constexpr uint8_t CLOSED = 1 << 2; //per cell search marks, the low 2 bits are the move that got there
 
     //genetic solver stuff
     std::vector<float> genes; //this is the chromosome, i.e., the weights for the policy
+    uint64_t seed{0}; //same seed gives the same playback every time
 
 
 };
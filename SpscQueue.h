@@ -0,0 +1,51 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+ * fixed size single producer / single consumer ring buffer. lock free, one thread pushes and one pops,
+ * used to stream progress from worker threads to the gui without the gui ever waiting on a mutex.
+ * if the consumer falls behind, push fails and the producer just drops that item
+ */
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+
+public:
+    bool push(const T& item) {
+        const size_t tail = writeIndex.load(std::memory_order_relaxed);
+        if (tail - readIndex.load(std::memory_order_acquire) == Capacity) {
+            return false; //full
+        }
+        slots[tail & (Capacity - 1)] = item;
+        writeIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire)) {
+            return false; //empty
+        }
+        item = slots[head & (Capacity - 1)];
+        readIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> slots{};
+    //separate cache lines so producer and consumer don't fight over the same line
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) std::atomic<size_t> readIndex{0};
+};
+
+
+
+#endif //SPSCQUEUE_H
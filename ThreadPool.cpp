@@ -0,0 +1,102 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(const size_t threadCount) {
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    auto future = packaged.get_future();
+    if (workers.empty()) {
+        packaged(); //no threads, just run it here
+        return future;
+    }
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(packaged));
+    }
+    wake.notify_one();
+    return future;
+}
+
+void ThreadPool::parallelFor(const size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    //hand out chunks from a shared counter, a few per thread so uneven items still balance out
+    struct Batch {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    const size_t threads = workers.size() + 1;
+    const size_t chunk = std::max<size_t>(1, count / (threads * 4));
+    auto batch = std::make_shared<Batch>();
+
+    auto work = [batch, chunk, count, &body] {
+        while (true) {
+            const size_t begin = batch->next.fetch_add(chunk);
+            if (begin >= count) {
+                return;
+            }
+            const size_t end = std::min(count, begin + chunk);
+            for (size_t i = begin; i < end; ++i) {
+                body(i);
+            }
+            if (batch->done.fetch_add(end - begin) + (end - begin) == count) {
+                std::lock_guard lock(batch->mutex);
+                batch->finished.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(workers.size(), (count + chunk - 1) / chunk - 1);
+    if (helpers > 0) {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < helpers; ++i) {
+            //helpers that start after everything is claimed return straight away, body is never touched
+            tasks.emplace_back(work);
+        }
+    }
+    wake.notify_all();
+    work();
+
+    std::unique_lock lock(batch->mutex);
+    batch->finished.wait(lock, [&] {return batch->done.load() == count;});
+}
+
+void ThreadPool::run() {
+    PROFILE_THREAD_NAME("pool worker");
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this] {return stopping || !tasks.empty();});
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
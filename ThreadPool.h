@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * small fixed size thread pool. submit() for fire and forget work with a future, parallelFor() for
+ * splitting an index range. the thread calling parallelFor does work too, and only waits on items that
+ * somebody already started, so it's fine to call it from inside a pool task
+ */
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::future<void> submit(std::function<void()> task);
+    //runs body(i) for every i in [0, count), blocks until all of them are done
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    [[nodiscard]] size_t getThreadCount() const {return workers.size();}
+
+private:
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stopping{false};
+    std::vector<std::thread> workers; //last, the threads use everything above
+};
+
+
+
+#endif //THREADPOOL_H
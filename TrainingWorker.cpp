@@ -0,0 +1,72 @@
+#include "TrainingWorker.h"
+#include "Profiler.h"
+#include <iostream>
+
+TrainingWorker::~TrainingWorker() {
+    cancel();
+    join();
+}
+
+bool TrainingWorker::start(GeneticAlgorithms& ga, const std::string& mazeFolder, const std::string& outputFile,
+                           const std::string& resumeFile) {
+    if (running) {
+        return false;
+    }
+    join(); //previous run finished but the thread still needs joining
+    cancelled = false;
+    paused = false;
+    running = true;
+
+    worker = std::thread([this, &ga, mazeFolder, outputFile, resumeFile] {
+        PROFILE_THREAD_NAME("training");
+        ga.setGenerationCallback([this](const GenerationStats& stats) {
+            //if the gui is behind the queue just drops the entry, training never waits on it
+            progress.push(stats);
+            while (paused && !cancelled) {
+                paused.wait(true);
+            }
+            return !cancelled.load();
+        });
+
+        ga.loadMazes(mazeFolder);
+        if (ga.getMazes().empty()) {
+            std::cerr << "No mazes in " << mazeFolder << ", nothing to train on" << std::endl;
+        }
+        else if (resumeFile.empty()) {
+            ga.train();
+            ga.saveBestChromosome(outputFile);
+        }
+        else if (ga.resume(resumeFile)) {
+            ga.saveBestChromosome(outputFile);
+        }
+        ga.setGenerationCallback(nullptr);
+        running = false;
+    });
+    return true;
+}
+
+void TrainingWorker::unpause() {
+    paused = false;
+    paused.notify_all();
+}
+
+void TrainingWorker::cancel() {
+    cancelled = true;
+    unpause(); //wake it up if it's parked so it can see the cancel
+}
+
+size_t TrainingWorker::drainProgress(std::vector<GenerationStats>& history) {
+    size_t count = 0;
+    GenerationStats stats;
+    while (progress.pop(stats)) {
+        history.push_back(stats);
+        ++count;
+    }
+    return count;
+}
+
+void TrainingWorker::join() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
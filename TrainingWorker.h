@@ -0,0 +1,50 @@
+#ifndef TRAININGWORKER_H
+#define TRAININGWORKER_H
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GeneticAlgorithms.h"
+#include "SpscQueue.h"
+
+/*
+ * runs GeneticAlgorithms::train on its own thread so the window keeps drawing while it trains.
+ * progress comes back through a lock free queue the gui drains once per frame, and pause/cancel
+ * are just atomics the training thread checks between generations.
+ * the ga must not be touched by anyone else while isRunning() is true
+ */
+
+class TrainingWorker {
+public:
+    TrainingWorker() = default;
+    ~TrainingWorker();
+    TrainingWorker(const TrainingWorker&) = delete;
+    TrainingWorker& operator=(const TrainingWorker&) = delete;
+
+    //loads the mazes and trains (or resumes from the checkpoint), then saves the best chromosome
+    bool start(GeneticAlgorithms& ga, const std::string& mazeFolder, const std::string& outputFile,
+               const std::string& resumeFile = "");
+    void pause() {paused = true;}
+    void unpause();
+    void cancel();
+
+    [[nodiscard]] bool isRunning() const {return running;}
+    [[nodiscard]] bool isPaused() const {return paused;}
+
+    //gui side, pulls everything published since the last call into history
+    size_t drainProgress(std::vector<GenerationStats>& history);
+
+private:
+    void join();
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> cancelled{false};
+    SpscQueue<GenerationStats, 1024> progress;
+};
+
+
+
+#endif //TRAININGWORKER_H
@@ -0,0 +1,50 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*
+ * one writer, one reader, neither ever waits. the writer fills its own slot and publish() swaps it with the
+ * middle one, the reader's update() swaps the middle one into its slot if something new landed there.
+ * so the reader always has a complete value to look at and just skips any the writer made in between.
+ * slots get reused, the writer has to overwrite everything in writeBuffer() before publishing
+ * (assigning into the old vectors keeps their memory, so that's cheap)
+ */
+
+template<typename T>
+class TripleBuffer {
+public:
+    T& writeBuffer() {return buffers[writeIndex];}
+
+    void publish() {
+        //release so the reader sees everything written into the slot
+        const uint8_t previous = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+        writeIndex = previous & INDEX_MASK;
+    }
+
+    //returns true if a newer value was picked up
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        const uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    [[nodiscard]] const T& read() const {return buffers[readIndex];}
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4; //middle slot holds something the reader hasn't taken yet
+
+    std::array<T, 3> buffers{};
+    uint8_t writeIndex{0}; //only touched by the writer
+    alignas(64) uint8_t readIndex{1}; //only touched by the reader, own line so the two don't false share
+    alignas(64) std::atomic<uint8_t> middle{2};
+};
+
+
+
+#endif //TRIPLEBUFFER_H
@@ -0,0 +1,271 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "../Generator.h"
+#include "../GeneticAlgorithms.h"
+#include "../IncrementalSolver.h"
+#include "../NoveltyArchive.h"
+#include "../Renderer.h"
+#include "../RolloutKernel.h"
+#include "../SolverAgent.h"
+
+/*
+ * microbenchmarks for the hot paths: generation, A* and replanning after an edit, rollouts, a whole generation
+ * of evaluation, training to a fixed rollout budget per evolution mode, novelty archive lookups, building the vertex arrays and .mz io. everything is seeded so runs are comparable,
+ * run with --benchmark_out=results.json --benchmark_out_format=json and diff against
+ * the baseline with bench/compare.py
+ */
+
+namespace {
+    constexpr uint64_t BENCH_SEED = 12345;
+
+    Maze makeMaze(const int size, const uint64_t seed = BENCH_SEED) {
+        Generator generator(size, size, seed);
+        generator.generateMaze();
+        return generator.getMaze();
+    }
+
+    //random genes from a fixed stream, same spread as initPopulation
+    Chromosome makeChromosome(const uint64_t index) {
+        RandomStream rng(BENCH_SEED, 0, index);
+        Chromosome chromosome;
+        chromosome.genes.resize(GeneticAlgorithms::getNumGenes());
+        for (auto &gene : chromosome.genes) {
+            gene = rng.nextFloat() * 2.0f - 1.0f;
+        }
+        return chromosome;
+    }
+}
+
+static void BM_GenerateMaze(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    Generator generator(size, size, BENCH_SEED);
+    for (auto _ : state) {
+        generator.generateMaze();
+        benchmark::DoNotOptimize(generator.getMaze().cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size * size); //cells per second
+}
+BENCHMARK(BM_GenerateMaze)->Arg(16)->Arg(64)->Arg(128)->Arg(2048)->Unit(benchmark::kMicrosecond);
+
+//one big maze in 256x256 tiles over a pool, compare against BM_GenerateMaze/2048 for the speedup
+static void BM_GenerateMazeTiled(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    Generator generator(size, size, BENCH_SEED);
+    ThreadPool pool;
+    for (auto _ : state) {
+        generator.generateMazeTiled(256, &pool);
+        benchmark::DoNotOptimize(generator.getMaze().cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_GenerateMazeTiled)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SolverSolve(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    SolverAgent solver{MazeHandle(makeMaze(size))};
+    solver.setGoalPosition(size - 1, size - 1);
+    for (auto _ : state) {
+        solver.solve();
+        benchmark::DoNotOptimize(solver.getSolution().data());
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_SolverSolve)->Arg(16)->Arg(64)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+//flip one random interior wall and repair the path, what an edit costs once the first solve is done
+static void BM_IncrementalReplan(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    IncrementalSolver solver{MazeHandle(makeMaze(size))};
+    solver.solve();
+    RandomStream rng(BENCH_SEED);
+    for (auto _ : state) {
+        const WallEdit edit{static_cast<int>(rng() % size), static_cast<int>(rng() % size),
+                            static_cast<int>(rng() % 4), rng.nextBool()};
+        solver.applyEdits({&edit, 1});
+        benchmark::DoNotOptimize(solver.solve());
+    }
+}
+BENCHMARK(BM_IncrementalReplan)->Arg(128)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+//one rollout through the kernel, items are steps so items_per_second is the per step cost
+static void BM_RolloutSteps(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const Maze maze = makeMaze(size);
+    const PreparedMaze prepared = RolloutKernel::prepare(maze);
+    const CompiledPolicy policy = RolloutKernel::compile(makeChromosome(0).genes.data());
+    int64_t steps = 0;
+    uint64_t rollout = 0;
+    for (auto _ : state) {
+        RandomStream rng(BENCH_SEED, 0, rollout++);
+        const RolloutState result = RolloutKernel::run(prepared, policy, rng, GeneticAlgorithms::getMaxSteps());
+        steps += result.steps;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(steps);
+}
+BENCHMARK(BM_RolloutSteps)->Arg(8)->Arg(16)->Arg(32);
+
+//the public one off evaluate, includes preparing the maze and compiling the genes every call
+static void BM_Evaluate(benchmark::State& state) {
+    const Maze maze = makeMaze(static_cast<int>(state.range(0)));
+    const GeneticAlgorithms ga(1, 1, 0.5f, 0.1f, BENCH_SEED);
+    const Chromosome chromosome = makeChromosome(0);
+    uint64_t rollout = 0;
+    for (auto _ : state) {
+        RandomStream rng(BENCH_SEED, 0, rollout++);
+        benchmark::DoNotOptimize(ga.evaluate(maze, chromosome, rng));
+    }
+}
+BENCHMARK(BM_Evaluate)->Arg(8)->Arg(16)->Arg(32);
+
+//one full generation of scoring: population 100 over 20 mazes. arg is the thread count, 0 means every core
+static void BM_EvaluateChromosomes(benchmark::State& state) {
+    GeneticAlgorithms ga(100, 1, 0.5f, 0.1f, BENCH_SEED);
+    if (state.range(0) > 0) {
+        ga.setThreadCount(static_cast<size_t>(state.range(0)));
+    }
+    std::vector<Maze> mazes;
+    for (uint64_t i = 0; i < 20; ++i) {
+        mazes.push_back(makeMaze(8, BENCH_SEED + i));
+    }
+    ga.setMazes(std::move(mazes));
+    ga.initPopulation(100);
+    for (auto _ : state) {
+        ga.evaluateChromosomes();
+        benchmark::DoNotOptimize(ga.getPopulation().data());
+    }
+    state.SetItemsProcessed(state.iterations() * 100 * 20); //rollouts per second
+}
+BENCHMARK(BM_EvaluateChromosomes)->Arg(1)->Arg(0)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//a whole training run on 20 5x5 mazes with the same budget of 3000 chromosome evaluations, so the best_fitness
+//counter says which mode gets further for the same rollouts. args are the evolution mode and population, cma-es
+//at its default lambda (14 for 28 genes) against the generational ga at 100
+static void BM_TrainToBudget(benchmark::State& state) {
+    constexpr size_t budget = 3000;
+    const auto mode = static_cast<EvolutionMode>(state.range(0));
+    const auto population = static_cast<size_t>(state.range(1));
+    std::vector<Maze> mazes;
+    for (uint64_t i = 0; i < 20; ++i) {
+        mazes.push_back(makeMaze(5, BENCH_SEED + i));
+    }
+    float best = 0.0f;
+    for (auto _ : state) {
+        GeneticAlgorithms ga(population, budget / population, 0.5f, 0.1f, BENCH_SEED);
+        ga.setEvolutionMode(mode);
+        ga.setConsoleLogging(false);
+        ga.setMazes(mazes);
+        ga.train();
+        best = ga.getBestChromosome().objective;
+    }
+    state.counters["best_fitness"] = best;
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(budget / population * population * 20));
+}
+BENCHMARK(BM_TrainToBudget)
+    ->Args({static_cast<int64_t>(EvolutionMode::Generational), 100})
+    ->Args({static_cast<int64_t>(EvolutionMode::CmaEs), 14})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//k nearest (k = 15) in a novelty archive of 18 float behaviours. second arg 1 makes the search exact,
+//which at these sizes is about what a plain scan costs
+static void BM_NoveltyQuery(benchmark::State& state) {
+    constexpr size_t dimensions = 18;
+    const auto size = static_cast<size_t>(state.range(0));
+    NoveltyArchive archive(dimensions);
+    if (state.range(1) != 0) {
+        archive.setMaxChecks(size);
+    }
+    //behaviours bunch up around a few common ones, so clustered rather than uniform
+    RandomStream rng(BENCH_SEED);
+    std::vector<float> centres(64 * dimensions);
+    for (float& value : centres) {
+        value = rng.nextFloat();
+    }
+    std::vector<float> behaviours(size * dimensions);
+    for (size_t i = 0; i < size; ++i) {
+        const float* centre = centres.data() + rng() % 64 * dimensions;
+        for (size_t d = 0; d < dimensions; ++d) {
+            behaviours[i * dimensions + d] = centre[d] + (rng.nextFloat() - 0.5f) * 0.2f;
+        }
+    }
+    archive.add(behaviours.data(), size);
+    std::vector<float> distances;
+    size_t query = 0;
+    for (auto _ : state) {
+        archive.nearest(behaviours.data() + (query++ * 7919 % size) * dimensions, 15, distances);
+        benchmark::DoNotOptimize(distances.data());
+    }
+}
+BENCHMARK(BM_NoveltyQuery)->Args({10000, 0})->Args({1000000, 0})->Args({1000000, 1})
+    ->Unit(benchmark::kMicrosecond);
+
+//vertex arrays for the maze at the default window size, no window or gl context involved
+static void BM_BuildVertexArrays(benchmark::State& state) {
+    const Maze maze = makeMaze(static_cast<int>(state.range(0)));
+    sf::VertexArray cells;
+    sf::VertexArray walls;
+    for (auto _ : state) {
+        Renderer::buildMesh(maze, {1000, 1000}, 2.0f, cells, walls);
+        benchmark::DoNotOptimize(walls.getVertexCount());
+    }
+    state.SetItemsProcessed(state.iterations() * maze.cells.size());
+    state.counters["vertices"] = static_cast<double>(cells.getVertexCount() + walls.getVertexCount());
+}
+BENCHMARK(BM_BuildVertexArrays)->Arg(16)->Arg(64)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+//same build split into row bands over a pool, only kicks in from 128x128 up
+static void BM_BuildVertexArraysPooled(benchmark::State& state) {
+    const Maze maze = makeMaze(static_cast<int>(state.range(0)));
+    ThreadPool pool;
+    sf::VertexArray cells;
+    sf::VertexArray walls;
+    for (auto _ : state) {
+        Renderer::buildMesh(maze, {1000, 1000}, 2.0f, cells, walls, nullptr, &pool);
+        benchmark::DoNotOptimize(walls.getVertexCount());
+    }
+    state.SetItemsProcessed(state.iterations() * maze.cells.size());
+    state.counters["vertices"] = static_cast<double>(cells.getVertexCount() + walls.getVertexCount());
+}
+BENCHMARK(BM_BuildVertexArraysPooled)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+static void BM_MazeSave(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    Generator generator(size, size, BENCH_SEED);
+    generator.generateMaze();
+    const std::string fileName = (std::filesystem::temp_directory_path() / "bench_save.mz").string();
+    for (auto _ : state) {
+        if (!generator.saveMazeToFile(fileName)) {
+            state.SkipWithError("failed to save maze");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size * size);
+    std::filesystem::remove(fileName);
+}
+BENCHMARK(BM_MazeSave)->Arg(16)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+static void BM_MazeLoad(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    Generator generator(size, size, BENCH_SEED);
+    generator.generateMaze();
+    const std::string fileName = (std::filesystem::temp_directory_path() / "bench_load.mz").string();
+    if (!generator.saveMazeToFile(fileName)) {
+        state.SkipWithError("failed to write the maze to load");
+        return;
+    }
+    Generator loader(size, size, BENCH_SEED);
+    for (auto _ : state) {
+        if (!loader.loadMazeFromFile(fileName)) {
+            state.SkipWithError("failed to load maze");
+            break;
+        }
+        benchmark::DoNotOptimize(loader.getMaze().cells.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size * size);
+    std::filesystem::remove(fileName);
+}
+BENCHMARK(BM_MazeLoad)->Arg(16)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
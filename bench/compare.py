@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+compare a benchmark run against the stored baseline and fail if anything got slower than the threshold.
+
+    compare.py bench/baseline.json results.json [--threshold 0.10]
+    compare.py --update bench/baseline.json results.json     (accept the new numbers as the baseline)
+
+both files are google benchmark json (--benchmark_out_format=json). when a run used --benchmark_repetitions
+the median is compared, otherwise the single result. times are in ns whatever unit the benchmark printed in.
+"""
+import argparse
+import json
+import shutil
+import sys
+
+UNIT_TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, field):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    medians = {}
+    for bench in data.get("benchmarks", []):
+        value = bench[field] * UNIT_TO_NS[bench.get("time_unit", "ns")]
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = value
+        else:
+            results[bench.get("run_name", bench["name"])] = value
+    results.update(medians)
+    return results
+
+
+def format_ns(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.2f} {unit}"
+    return f"{ns:.1f} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare benchmark json against a baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown, 0.10 = 10%%")
+    parser.add_argument("--field", default="real_time", choices=["real_time", "cpu_time"])
+    parser.add_argument("--update", action="store_true", help="copy current over the baseline and exit")
+    args = parser.parse_args()
+
+    if args.update:
+        shutil.copyfile(args.current, args.baseline)
+        print(f"baseline updated from {args.current}")
+        return 0
+
+    try:
+        baseline = load(args.baseline, args.field)
+    except FileNotFoundError:
+        print(f"no baseline at {args.baseline}, record one with --update")
+        return 1
+    current = load(args.current, args.field)
+
+    regressions = []
+    width = max((len(name) for name in current), default=10)
+    print(f"{'benchmark':<{width}}  {'baseline':>12}  {'current':>12}  {'change':>8}")
+    for name, value in current.items():
+        if name not in baseline:
+            print(f"{name:<{width}}  {'-':>12}  {format_ns(value):>12}  {'new':>8}")
+            continue
+        change = value / baseline[name] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  <-- slower"
+            regressions.append(name)
+        print(f"{name:<{width}}  {format_ns(baseline[name]):>12}  {format_ns(value):>12}  {change:>+7.1%}{flag}")
+    for name in baseline:
+        if name not in current:
+            print(f"{name:<{width}}  {format_ns(baseline[name]):>12}  {'-':>12}  {'gone':>8}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+    print("\nno regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <imgui.h>
@@ -5,10 +6,17 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/System/Clock.hpp>
 #include <SFML/Window/Event.hpp>
+#include "AsyncIO.h"
 #include "Generator.h"
+#include "MazeHash.h"
+#include "MazeIO.h"
 #include "Renderer.h"
+#include "RolloutKernel.h"
+#include "Simulation.h"
 #include "SolverAgent.h"
 #include "GeneticAlgorithms.h"
+#include "TrainingWorker.h"
+#include "Profiler.h"
 
 
 int main() {
@@ -23,16 +31,34 @@ int main() {
 
     Generator maze(10, 10);
     Renderer renderer(window, 1.0f);
-    SolverAgent solver = SolverAgent(maze.getMaze());
-    renderer.setFramerateLimit(240.0f);
-    Maze currentMaze = maze.getMaze();
-    renderer.buildVertexArrays(currentMaze);
+    SolverAgent solver = SolverAgent(maze.getHandle());
+    //animations step on their own thread, the window just draws the newest snapshot at whatever fps it gets
+    Simulation simulation;
+    simulation.showMaze(maze.getHandle());
 
 
 
     //create genetic agent stuff
     GeneticAlgorithms ga = GeneticAlgorithms(10, 10, 0.55f, 0.1f);
-
+    //training runs on here so the window doesn't freeze, declared after ga so it stops first
+    TrainingWorker trainer;
+    std::vector<GenerationStats> trainingHistory;
+    std::vector<float> bestHistory;
+    std::vector<float> averageHistory;
+
+
+    //file io runs on its own threads, the results get picked up once a frame below
+    AsyncIO io;
+    std::future<bool> pendingSave;
+    std::string pendingSavePath;
+    std::future<AsyncIO::ReadResult> pendingLoad;
+    std::vector<std::future<size_t>> pendingBatchWrites;
+    size_t pendingBatchCount = 0;
+    size_t pendingBatchSkipped = 0;
+    std::string pendingBatchFolder;
+    auto ready = [](const auto& future) {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
 
     //create maze folders
     std::filesystem::create_directory("mazes");
@@ -48,24 +74,27 @@ int main() {
     static int mazeHeight = 5;
     static bool visualizeGeneration = false;
     static bool visualizeSearch = false;
-    static bool animating = false;
-    static bool searching = false;
 
     //static bool paused = false;
     //bool stepOnce = false;
     //static bool stepThrough = false;
-    static float frameRate = 60.0f;
+    static float stepRate = 60.0f;
 
     static int train_size = 250;
     static int test_size = 100;
+    static bool dedupSymmetric = false;
     static int populationSize = 100;
     static int generations = 100;
 
     ga.setPopulationSize(populationSize);
     ga.setGenerationCount(generations);
+    ga.setCheckpointing("ga_checkpoint.bin", 10); //snapshot every 10 generations so a killed run can resume
+    ga.setConsoleLogging(true, 2.0f);
 
 
+    PROFILE_THREAD_NAME("main");
     while (window.isOpen()) {
+        PROFILE_SCOPE("frame");
         // Process events, including window close
         while (const auto event = window.pollEvent()) {
             ImGui::SFML::ProcessEvent(window, *event);
@@ -77,7 +106,7 @@ int main() {
                 // Update the view to the new size of the window
                 sf::FloatRect visibleArea({0.f, 0.f}, sf::Vector2f(resized->size));
                 window.setView(sf::View(visibleArea));
-                renderer.buildVertexArrays(maze.getMaze());
+                renderer.setDirty();
             }
         }
         sf::Time deltaTime = deltaClock.restart();
@@ -91,30 +120,46 @@ int main() {
         window.setView(mazeView);
 
         //Put render code here
-        if (animating) {
-            renderer.updateGenAnim(deltaTime.asSeconds());
-            renderer.drawAnim();
-            if (renderer.getAnimationFinished()) {
-                animating = false;
-            }
-        }
-        else if (searching) {
-            renderer.updateSearchAnim(deltaTime.asSeconds());
-            renderer.drawAnim();
-            if (renderer.getSearchFinished()) {
-                renderer.highlightSolution(maze.getMaze(), solver.getSolution());
-                visualizeSearch = false;
-            }
-        }
-
-        else {
-            renderer.renderMaze(maze.getMaze());
+        {
+            PROFILE_SCOPE("draw maze");
+            renderer.draw(simulation.latest());
         }
 
         //split controls back to the left of screen
         window.setView(window.getDefaultView());
 
 
+        //finish off any file io that completed since last frame
+        if (ready(pendingSave)) {
+            if (pendingSave.get()) {
+                snprintf(message, sizeof(message), "Maze saved to %s", pendingSavePath.c_str());
+            } else {
+                snprintf(message, sizeof(message), "Error saving maze to %s", pendingSavePath.c_str());
+            }
+        }
+        if (ready(pendingLoad)) {
+            AsyncIO::ReadResult result = pendingLoad.get();
+            Maze loadedMaze;
+            if (result.ok && MazeIO::decode(result.data.data(), result.data.size(), loadedMaze)) {
+                //decoded once, then the generator, solver and simulation all share it
+                maze.setMaze(MazeHandle(std::move(loadedMaze)));
+                solver.rebuild(maze.getHandle());
+                snprintf(message, sizeof(message), "Loaded from %s", result.fileName.c_str());
+                simulation.showMaze(maze.getHandle());
+            } else {
+                snprintf(message, sizeof(message), "Error loading maze from %s", result.fileName.c_str());
+            }
+        }
+        if (!pendingBatchWrites.empty() && std::ranges::all_of(pendingBatchWrites, ready)) {
+            size_t written = 0;
+            for (auto& write : pendingBatchWrites) {
+                written += write.get();
+            }
+            pendingBatchWrites.clear();
+            std::cout << "Generated " << written << "/" << pendingBatchCount << " mazes in " << pendingBatchFolder
+                      << " folder (" << pendingBatchSkipped << " duplicates skipped)" << std::endl;
+        }
+
         // ImGui window for simulation controls
         ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
         ImGui::SetNextWindowBgAlpha(0.5f);
@@ -123,28 +168,16 @@ int main() {
 
         ImGui::InputText("Save As", savePath, IM_ARRAYSIZE(savePath));
         //ImGui::SameLine();
-        if (ImGui::Button("Save Maze")) {
-            if (maze.saveMazeToFile(savePath)) {
-                snprintf(message, sizeof(message), "Maze saved to %s", savePath);
-            } else {
-                snprintf(message, sizeof(message), "Error saving maze to %s", savePath);
-            }
+        if (ImGui::Button("Save Maze") && !pendingSave.valid()) {
+            pendingSavePath = savePath;
+            pendingSave = io.write(pendingSavePath, MazeIO::encode(maze.getMaze()));
+            snprintf(message, sizeof(message), "Saving to %s...", savePath);
         }
         ImGui::InputText("Load From", loadPath, IM_ARRAYSIZE(loadPath));
         //ImGui::SameLine();
-        if (ImGui::Button("Load Maze")) {
-            if (maze.loadMazeFromFile(loadPath)) {
-                Maze loadedMaze = maze.getMaze();
-                currentMaze = loadedMaze;
-                maze.reset();
-                maze.setMaze(currentMaze);
-                solver.rebuild(maze.getMaze());
-                //solver = SolverAgent(maze.getMaze());
-                snprintf(message, sizeof(message), "Loaded from %s", loadPath);
-                renderer.buildVertexArrays(maze.getMaze());
-            } else {
-                snprintf(message, sizeof(message), "Error loading maze from %s", loadPath);
-            }
+        if (ImGui::Button("Load Maze") && !pendingLoad.valid()) {
+            pendingLoad = io.read(loadPath);
+            snprintf(message, sizeof(message), "Loading %s...", loadPath);
         }
         const ImVec2 data_pos = ImGui::GetWindowSize();
         ImGui::Text("%s", message);
@@ -159,16 +192,12 @@ int main() {
         ImGui::Checkbox("Visualize Maze Generation", &visualizeGeneration);
         //ImGui::Checkbox("Pause", &animating);
         ImGui::PushItemWidth( ImGui::GetWindowWidth() * 0.9f );
-        ImGui::SliderFloat("##", &frameRate, 30.0f, 240.0f);
-
-        ImGui::Text("Animation Framerate: %.2f", frameRate);
-        ImGui::PopItemWidth();
-        if (animating || searching) {
-            renderer.setFramerateLimit(frameRate);
-        }
-        else {
-            renderer.setFramerateLimit(60.0f);
+        //steps per second of the animation, independent of the frame rate so it can go well past it
+        if (ImGui::SliderFloat("##", &stepRate, 1.0f, 100000.0f, "%.0f steps/s", ImGuiSliderFlags_Logarithmic)) {
+            simulation.setStepRate(stepRate);
         }
+        ImGui::Text("Animation Speed: %.0f steps/s", stepRate);
+        ImGui::PopItemWidth();
 
         //add size for maze inputs
         ImGui::PushItemWidth( ImGui::GetWindowWidth() * 0.6f );
@@ -184,18 +213,14 @@ int main() {
 
         if (ImGui::Button("Generate Maze")) {
             maze = Generator(mazeWidth, mazeHeight);
-            solver.rebuild(maze.getMaze());
             maze.generateMaze();
-            renderer.setDirty();
-            searching = false;
-            renderer.buildVertexArrays(maze.getMaze());
-
+            //after generating, the solver holds on to whichever version it's given
+            solver.rebuild(maze.getHandle());
             if (visualizeGeneration) {
-                renderer.startAnimation(maze.getMaze(), maze.getMovements());
-                animating = true;
+                simulation.startGeneration(maze.getHandle(), maze.getReplay());
             }
             else {
-                animating = false;
+                simulation.showMaze(maze.getHandle());
             }
         }
 
@@ -213,18 +238,20 @@ int main() {
             solver.reset();
             solver.setStartPosition(0, 0);
             solver.setGoalPosition(maze.getMaze().width - 1, maze.getMaze().height - 1);
-            solver.solve();
-            renderer.buildVertexArrays(maze.getMaze());
             if (visualizeSearch) {
-                renderer.startSearchAnim(maze.getMaze(), solver.getPath());
-                searching = true;
+                //the search runs as it's drawn, nothing is solved up front
+                simulation.startSearch(maze.getHandle(), solver.searchSteps());
             }
             else {
-                searching = false;
+                solver.solve();
+                simulation.showMaze(maze.getHandle());
             }
         }
         if (ImGui::Button("Show Solution")) {
-            renderer.highlightSolution(maze.getMaze(), solver.getSolution());
+            if (solver.getSolution().empty()) {
+                solver.solve();
+            }
+            simulation.showSolution(maze.getHandle(), solver.getSolution());
         }
         ImVec2 solverPos = ImGui::GetWindowSize();
         ImGui::End();
@@ -234,30 +261,43 @@ int main() {
         ImGui::SetNextWindowSize({window.getSize().x * 0.2f, windowHeight * 0.1}, ImGuiCond_Always);
         ImGui::SetNextWindowBgAlpha(0.5f);
         ImGui::Begin("Batch Generation", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
-        if (ImGui::Button("Generate Train Mazes")) {
-            std::filesystem::remove_all("train_mazes");
-            //put batch into train_mazes folder
-            std::filesystem::create_directory("train_mazes");
-            for (int i = 0; i < train_size; ++i) {
-                maze = Generator(mazeWidth, mazeHeight);
-                maze.generateMaze();
-                std::string fileName = "train_mazes/maze" + std::to_string(i) + ".mz";
-                maze.saveMazeToFile(fileName);
+        //generation still happens here, the files go out in batches on the io threads while it carries on.
+        //one set at a time so a folder isn't wiped while it's still being written.
+        //duplicates are thrown away and another maze generated in their place, small sizes repeat a lot
+        auto generateSet = [&](const std::string& folder, const int count) {
+            std::filesystem::remove_all(folder);
+            std::filesystem::create_directory(folder);
+            std::vector<AsyncIO::WriteRequest> batch;
+            MazeSet seen(dedupSymmetric);
+            int generated = 0;
+            pendingBatchSkipped = 0;
+            //give up after 8 tries a maze, a 2x2 only has a handful of different mazes
+            for (int attempt = 0; attempt < count * 8 && generated < count; ++attempt) {
+                Generator generator(mazeWidth, mazeHeight);
+                generator.generateMaze();
+                if (!seen.insert(generator.getMaze())) {
+                    ++pendingBatchSkipped;
+                    continue;
+                }
+                batch.push_back({folder + "/maze" + std::to_string(generated++) + MazeIO::EXTENSION, MazeIO::encode(generator.getMaze())});
+                if (batch.size() == 64) {
+                    pendingBatchWrites.push_back(io.writeBatch(std::move(batch)));
+                    batch.clear();
+                }
             }
-            std::cout << "Generated " << train_size << " mazes in train_mazes folder" << std::endl;
-
-        }
-        if (ImGui::Button("Generate Test Mazes")) {
-            std::filesystem::remove_all("test_mazes");
-            std::filesystem::create_directory("test_mazes");
-            for (int i = 0; i < test_size; ++i) {
-                maze = Generator(mazeWidth, mazeHeight);
-                maze.generateMaze();
-                std::string fileName = "test_mazes/maze" + std::to_string(i) + ".mz";
-                maze.saveMazeToFile(fileName);
+            if (!batch.empty()) {
+                pendingBatchWrites.push_back(io.writeBatch(std::move(batch)));
             }
-            std::cout << "Generated " << test_size << " mazes in test_mazes folder" << std::endl;
-
+            pendingBatchCount = generated;
+            pendingBatchFolder = folder;
+        };
+        ImGui::Checkbox("Mirrored Mazes Count As Duplicates", &dedupSymmetric);
+        if (ImGui::Button("Generate Train Mazes") && pendingBatchWrites.empty()) {
+            //put batch into train_mazes folder
+            generateSet("train_mazes", train_size);
+        }
+        if (ImGui::Button("Generate Test Mazes") && pendingBatchWrites.empty()) {
+            generateSet("test_mazes", test_size);
         }
 
         ImVec2 batchPos = ImGui::GetWindowSize();
@@ -268,11 +308,73 @@ int main() {
         ImGui::SetNextWindowSize({window.getSize().x * 0.2f, windowHeight * 0.2f}, ImGuiCond_Always);
         ImGui::SetNextWindowBgAlpha(0.5f);
         ImGui::Begin("Genetic Algorithms", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
-        if (ImGui::Button("Train Agent")) {
-            ga.loadMazes("train_mazes");
+        //pull in whatever the training thread has published since last frame
+        const size_t previousCount = trainingHistory.size();
+        trainer.drainProgress(trainingHistory);
+        for (size_t i = previousCount; i < trainingHistory.size(); ++i) {
+            bestHistory.push_back(trainingHistory[i].bestFitness);
+            averageHistory.push_back(trainingHistory[i].averageFitness);
+        }
 
-            ga.train();
-            ga.saveBestChromosome("best_chromosome.bin");
+        if (!trainer.isRunning()) {
+            static int evolutionMode = 0;
+            static const char* evolutionModes[] = {"Generational", "Steady State", "Mu + Lambda", "CMA-ES"};
+            if (ImGui::Combo("Mode", &evolutionMode, evolutionModes, IM_ARRAYSIZE(evolutionModes))) {
+                ga.setEvolutionMode(static_cast<EvolutionMode>(evolutionMode));
+            }
+            static bool curriculum = false;
+            if (ImGui::Checkbox("Curriculum", &curriculum)) {
+                ga.setCurriculum(curriculum); //easy mazes first
+            }
+            static bool novelty = false;
+            static float noveltyWeight = 1.0f;
+            if (ImGui::Checkbox("Novelty Search", &novelty)) {
+                ga.setNoveltySearch(novelty, noveltyWeight); //reward doing something new, not just getting close
+            }
+            if (novelty && ImGui::SliderFloat("Novelty Weight", &noveltyWeight, 0.0f, 1.0f)) {
+                ga.setNoveltySearch(novelty, noveltyWeight);
+            }
+            const bool train = ImGui::Button("Train Agent");
+            const bool resume = ImGui::Button("Resume Training");
+            if (train || resume) {
+                trainingHistory.clear();
+                bestHistory.clear();
+                averageHistory.clear();
+                trainer.start(ga, "train_mazes", "best_chromosome.bin", resume ? "ga_checkpoint.bin" : "");
+            }
+            if (ImGui::Button("Play Population")) {
+                //every chromosome on the current maze at once, how the whole population behaves at a glance
+                std::vector<CompiledPolicy> policies;
+                policies.reserve(ga.getPopulation().size());
+                for (const Chromosome& chromosome : ga.getPopulation()) {
+                    policies.push_back(RolloutKernel::compile(chromosome.genes.data()));
+                }
+                simulation.startPopulation(maze.getHandle(), std::move(policies), GeneticAlgorithms::getMaxSteps(),
+                                           ga.getSeed());
+            }
+        }
+        else {
+            if (trainer.isPaused() ? ImGui::Button("Continue") : ImGui::Button("Pause")) {
+                if (trainer.isPaused()) {
+                    trainer.unpause();
+                }
+                else {
+                    trainer.pause();
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                trainer.cancel();
+            }
+        }
+        if (!trainingHistory.empty()) {
+            const GenerationStats& latest = trainingHistory.back();
+            ImGui::ProgressBar(static_cast<float>(latest.generation + 1) / static_cast<float>(latest.generationCount));
+            ImGui::Text("Best: %.1f  Avg: %.1f", latest.bestFitness, latest.averageFitness);
+            ImGui::Text("Mazes: %zu", latest.activeMazes);
+            ImGui::Text("%.0f rollouts/s", latest.rolloutsPerSecond);
+            ImGui::PlotLines("Best", bestHistory.data(), static_cast<int>(bestHistory.size()));
+            ImGui::PlotLines("Average", averageHistory.data(), static_cast<int>(averageHistory.size()));
         }
         if (ImGui::Button("Load Agent")) {
             solver.loadGenes("best_chromosome.bin");
@@ -282,14 +384,12 @@ int main() {
             solver.reset();
             solver.setStartPosition(0, 0);
             solver.setGoalPosition(maze.getMaze().width - 1, maze.getMaze().height - 1);
-            solver.solveGenetic();
-            renderer.buildVertexArrays(maze.getMaze());
             if (visualizeSearch) {
-                renderer.startSearchAnim(maze.getMaze(), solver.getPath());
-                searching = true;
+                simulation.startSearch(maze.getHandle(), solver.agentSteps());
             }
             else {
-                searching = false;
+                solver.solveGenetic();
+                simulation.showMaze(maze.getHandle());
             }
         }
         ImVec2 genPos = ImGui::GetWindowSize();
@@ -301,12 +401,68 @@ int main() {
         //ImGui::SetNextWindowSize(ImVec2(200, 100));
         ImGui::Begin("Simulation Data", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
         ImGui::Text("Frame Rate: %.1f FPS", 1.0f / ImGui::GetIO().DeltaTime);
+        if (simulation.isAnimating()) {
+            const SimulationSnapshot& shown = simulation.latest();
+            if (shown.totalSteps > 0) {
+                ImGui::Text("Step %zu / %zu", shown.step, shown.totalSteps);
+            }
+            else {
+                ImGui::Text("Step %zu", shown.step);
+            }
+            if (shown.mode == SimulationMode::Population) {
+                ImGui::Text("At goal: %zu / %zu", shown.arrived, shown.agents.size());
+            }
+        }
+        if (ImGui::CollapsingHeader("Profiler")) {
+            if (!Profiler::enabled) {
+                ImGui::TextDisabled("Build with MAZE_ENABLE_PROFILING for timings");
+            }
+            else {
+                const Profiler::Summary profile = Profiler::summary();
+                for (size_t i = 0; i < Profiler::COUNTER_COUNT; ++i) {
+                    ImGui::Text("%s: %llu", Profiler::counterName(static_cast<Profiler::Counter>(i)),
+                                static_cast<unsigned long long>(profile.counters[i]));
+                }
+                if (ImGui::BeginTable("scopes", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+                    ImGui::TableSetupColumn("Scope");
+                    ImGui::TableSetupColumn("Calls");
+                    ImGui::TableSetupColumn("Avg ms");
+                    ImGui::TableSetupColumn("Max ms");
+                    ImGui::TableHeadersRow();
+                    for (const auto& scope : profile.scopes) {
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(scope.name);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%llu", static_cast<unsigned long long>(scope.calls));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", scope.totalNs / 1e6 / static_cast<double>(scope.calls));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", scope.maxNs / 1e6);
+                    }
+                    ImGui::EndTable();
+                }
+                if (ImGui::Button("Reset")) {
+                    Profiler::reset();
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Export Trace")) {
+                    //open in ui.perfetto.dev or chrome://tracing
+                    if (Profiler::writeChromeTrace("maze_trace.json")) {
+                        snprintf(message, sizeof(message), "Trace saved to maze_trace.json");
+                    }
+                }
+            }
+        }
         ImGui::End();
 
 
 
-        ImGui::SFML::Render(window);
-        window.display();
+        {
+            PROFILE_SCOPE("present");
+            ImGui::SFML::Render(window);
+            window.display();
+        }
     }
 
     ImGui::SFML::Shutdown();
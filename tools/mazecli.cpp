@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "../AsyncIO.h"
+#include "../Generator.h"
+#include "../GeneticAlgorithms.h"
+#include "../IncrementalSolver.h"
+#include "../MazeAnalytics.h"
+#include "../MazeHash.h"
+#include "../MazeIO.h"
+#include "../MazePrefetcher.h"
+#include "../NoveltyArchive.h"
+#include "../Profiler.h"
+#include "../RolloutKernel.h"
+#include "../SolverAgent.h"
+#include "../ThreadPool.h"
+
+/*
+ * headless front end for the core library, for machines with no display (training nodes, ci).
+ *
+ *   mazecli generate <folder> [--count 250] [--width 5] [--height 5] [--seed N] [--tile N] [--threads N]
+ *                    [--duplicates] [--symmetric]
+ *   mazecli solve <maze.mz or folder> [--genes best_chromosome.bin]
+ *   mazecli train <maze folder> [--population 100] [--generations 100] [--mode generational|steady|mupluslambda|cmaes]
+ *                 [--threads N] [--seed N] [--out best_chromosome.bin] [--checkpoint ga_checkpoint.bin] [--resume]
+ *                 [--curriculum] [--novelty [weight]] [--min-solution N] [--max-solution N] [--perfect]
+ *   mazecli stats <maze folder> [--min-solution N] [--max-solution N] [--perfect] [--list] [--symmetric]
+ *                 [--threads N]
+ *   mazecli bench [--size 64] [--repeat 20] [--runs 1] [--json results.json]
+ *
+ * ctrl-c during train stops after the current generation and leaves a checkpoint to resume from.
+ * any command takes --trace trace.json to dump a chrome/perfetto trace at the end (profiling builds only)
+ */
+
+namespace {
+    constexpr size_t IO_BATCH_SIZE = 64; //maze files per async read/write batch
+    constexpr long long MAX_ATTEMPTS_PER_MAZE = 8; //generate gives up on filling a set of distinct mazes after this
+
+    volatile std::sig_atomic_t interrupted = 0;
+
+    void onInterrupt(int) {
+        interrupted = 1;
+    }
+
+    //--key value pairs after the positional argument, a flag with no value is stored as "1"
+    struct Arguments {
+        std::string positional;
+        std::map<std::string, std::string> options;
+
+        [[nodiscard]] std::string get(const std::string& key, const std::string& fallback) const {
+            const auto it = options.find(key);
+            return it == options.end() ? fallback : it->second;
+        }
+        [[nodiscard]] long long getInt(const std::string& key, const long long fallback) const {
+            const auto it = options.find(key);
+            return it == options.end() ? fallback : std::stoll(it->second);
+        }
+        [[nodiscard]] bool has(const std::string& key) const {return options.contains(key);}
+    };
+
+    Arguments parseArguments(const int argc, char** argv) {
+        Arguments arguments;
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg.starts_with("--")) {
+                const bool hasValue = i + 1 < argc && !std::string(argv[i + 1]).starts_with("--");
+                arguments.options[arg.substr(2)] = hasValue ? argv[++i] : "1";
+            }
+            else if (arguments.positional.empty()) {
+                arguments.positional = arg;
+            }
+        }
+        return arguments;
+    }
+
+    double secondsSince(const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //--threads, defaulting to every core. the caller helps in parallelFor so the pool gets one less
+    std::unique_ptr<ThreadPool> makePool(const Arguments& arguments) {
+        const auto threads = static_cast<size_t>(arguments.getInt("threads", std::thread::hardware_concurrency()));
+        return threads > 1 ? std::make_unique<ThreadPool>(threads - 1) : nullptr;
+    }
+
+    int runGenerate(const Arguments& arguments) {
+        const std::string folder = arguments.positional.empty() ? "train_mazes" : arguments.positional;
+        const auto count = arguments.getInt("count", 250);
+        const auto width = static_cast<int>(arguments.getInt("width", 5));
+        const auto height = static_cast<int>(arguments.getInt("height", 5));
+        const auto seed = static_cast<uint64_t>(arguments.getInt("seed", std::random_device{}()));
+        if (width < 1 || height < 1 || count < 0) {
+            std::cerr << "Maze size and count must be positive" << std::endl;
+            return 1;
+        }
+
+        //--tile carves each maze in tiles of that size across the threads, for single mazes too big to wait on
+        const auto tile = static_cast<size_t>(arguments.getInt("tile", 0));
+        const std::unique_ptr<ThreadPool> pool = tile > 0 ? makePool(arguments) : nullptr;
+
+        //a maze that's already in the set is skipped and another seed tried, --duplicates keeps them all.
+        //--symmetric counts rotations and reflections of a maze as the same maze
+        const bool unique = !arguments.has("duplicates");
+        MazeSet seen(arguments.has("symmetric"));
+        const long long attempts = unique ? count * MAX_ATTEMPTS_PER_MAZE : count;
+
+        std::filesystem::create_directories(folder);
+        Generator generator(width, height);
+        //files go out in batches on the io threads while the next batch is being generated
+        AsyncIO io;
+        std::vector<std::future<size_t>> writes;
+        std::vector<AsyncIO::WriteRequest> batch;
+        long long generated = 0;
+        long long skipped = 0;
+        for (long long i = 0; i < attempts && generated < count; ++i) {
+            //every maze gets its own seed off the base one, so a folder can be regenerated exactly
+            generator.setSeed(RandomStream::mix(seed + i));
+            if (tile > 0) {
+                generator.generateMazeTiled(tile, pool.get());
+            }
+            else {
+                generator.generateMaze();
+            }
+            if (unique && !seen.insert(generator.getMaze())) {
+                ++skipped;
+                continue;
+            }
+            batch.push_back({folder + "/maze" + std::to_string(generated++) + MazeIO::EXTENSION,
+                             MazeIO::encode(generator.getMaze())});
+            if (batch.size() == IO_BATCH_SIZE) {
+                writes.push_back(io.writeBatch(std::move(batch)));
+                batch.clear();
+            }
+        }
+        if (!batch.empty()) {
+            writes.push_back(io.writeBatch(std::move(batch)));
+        }
+        size_t written = 0;
+        for (auto& write : writes) {
+            written += write.get();
+        }
+        if (written != static_cast<size_t>(generated)) {
+            std::cerr << "Only wrote " << written << " of " << generated << " mazes" << std::endl;
+            return 1;
+        }
+        std::cout << "Generated " << generated << " " << width << "x" << height << " mazes in " << folder
+                  << " (seed " << seed << ", " << skipped << " duplicates skipped)" << std::endl;
+        if (generated < count) {
+            //tiny sizes just don't have that many different mazes
+            std::cerr << "Only found " << generated << " distinct mazes in " << attempts << " tries" << std::endl;
+        }
+        return 0;
+    }
+
+    int solveMaze(MazeHandle maze, const Arguments& arguments, const bool verbose) {
+        const int goalX = static_cast<int>(maze->width) - 1;
+        const int goalY = static_cast<int>(maze->height) - 1;
+        SolverAgent solver(std::move(maze));
+        solver.setGoalPosition(goalX, goalY);
+
+        const auto start = std::chrono::steady_clock::now();
+        if (arguments.has("genes")) {
+            solver.loadGenes(arguments.get("genes", "best_chromosome.bin"));
+            solver.solveGenetic();
+        }
+        else {
+            solver.solve();
+        }
+        const double seconds = secondsSince(start);
+
+        if (solver.getSolution().empty()) {
+            if (verbose) {
+                std::cout << "No solution found, visited " << solver.getVisitedCount() << " cells" << std::endl;
+            }
+            return 2;
+        }
+        if (verbose) {
+            std::cout << "Solution length " << solver.getSolution().size() << ", visited " << solver.getVisitedCount()
+                      << " cells in " << seconds * 1000.0 << " ms" << std::endl;
+        }
+        return 0;
+    }
+
+    //a single .mz, or every .mz in a folder with just a summary at the end
+    int runSolve(const Arguments& arguments) {
+        if (arguments.positional.empty()) {
+            std::cerr << "solve needs a .mz file or a folder of them" << std::endl;
+            return 1;
+        }
+        if (!std::filesystem::is_directory(arguments.positional)) {
+            Generator generator(1, 1);
+            if (!generator.loadMazeFromFile(arguments.positional)) {
+                return 1;
+            }
+            return solveMaze(generator.getHandle(), arguments, true);
+        }
+        const std::vector<std::string> files = MazePrefetcher::listFolder(arguments.positional);
+        size_t solved = 0;
+        const size_t total = files.size();
+        const auto start = std::chrono::steady_clock::now();
+        //the next batches are read while this one is being solved
+        AsyncIO io;
+        MazePrefetcher prefetcher(io, files, IO_BATCH_SIZE);
+        std::vector<Maze> batch;
+        while (prefetcher.next(batch)) {
+            for (Maze& maze : batch) {
+                if (solveMaze(MazeHandle(std::move(maze)), arguments, false) == 0) {
+                    ++solved;
+                }
+            }
+        }
+        std::cout << "Solved " << solved << "/" << total << " mazes in " << secondsSince(start) * 1000.0 << " ms"
+                  << std::endl;
+        return solved == total ? 0 : 2;
+    }
+
+    //--min-solution / --max-solution / --perfect, all optional
+    MazeAnalytics::Filter parseFilter(const Arguments& arguments) {
+        MazeAnalytics::Filter filter;
+        filter.minSolution = static_cast<uint32_t>(arguments.getInt("min-solution", 0));
+        filter.maxSolution = static_cast<uint32_t>(arguments.getInt("max-solution", UINT32_MAX));
+        filter.perfectOnly = arguments.has("perfect");
+        return filter;
+    }
+
+    bool hasFilter(const Arguments& arguments) {
+        return arguments.has("min-solution") || arguments.has("max-solution") || arguments.has("perfect");
+    }
+
+    //refreshes the folder's stats index and summarises whatever passes the filter
+    int runStats(const Arguments& arguments) {
+        const std::string folder = arguments.positional.empty() ? "train_mazes" : arguments.positional;
+        const std::unique_ptr<ThreadPool> pool = makePool(arguments);
+        std::vector<MazeAnalytics::IndexEntry> entries;
+        //--symmetric also counts distinct mazes up to rotation/reflection, which costs 7 turned copies of each
+        const bool symmetric = arguments.has("symmetric");
+        if (!MazeAnalytics::indexFolder(folder, entries, pool.get(), symmetric)) {
+            return 1;
+        }
+        const MazeAnalytics::Filter filter = parseFilter(arguments);
+        size_t selected = 0;
+        size_t perfect = 0;
+        double solution = 0.0;
+        double deadEnds = 0.0;
+        double junctions = 0.0;
+        double river = 0.0;
+        std::array<uint64_t, MazeStats::CORRIDOR_BUCKETS> corridors{};
+        std::unordered_set<uint64_t> distinct;
+        std::unordered_set<uint64_t> distinctShapes;
+        for (const auto& entry : entries) {
+            const MazeStats& stats = entry.stats;
+            if (stats.difficulty.pathLength < filter.minSolution || stats.difficulty.pathLength > filter.maxSolution ||
+                (filter.perfectOnly && !stats.isPerfect())) {
+                continue;
+            }
+            ++selected;
+            perfect += stats.isPerfect();
+            distinct.insert(stats.hash);
+            distinctShapes.insert(stats.canonicalHash);
+            solution += stats.difficulty.pathLength;
+            deadEnds += stats.deadEnds;
+            junctions += stats.junctions;
+            river += stats.riverFactor;
+            for (size_t i = 0; i < corridors.size(); ++i) {
+                corridors[i] += stats.corridors[i];
+            }
+            if (arguments.has("list")) {
+                std::cout << entry.fileName << " solution " << stats.difficulty.pathLength << " dead ends "
+                          << stats.deadEnds << (stats.isPerfect() ? "" : " (not perfect)") << std::endl;
+            }
+        }
+        std::cout << selected << "/" << entries.size() << " mazes selected, " << perfect << " perfect, " << distinct.size()
+                  << " distinct";
+        if (symmetric) {
+            std::cout << " (" << distinctShapes.size() << " up to rotation/reflection)";
+        }
+        std::cout << std::endl;
+        if (selected == 0) {
+            return 0;
+        }
+        const auto count = static_cast<double>(selected);
+        std::cout << "mean solution " << solution / count << ", dead ends " << deadEnds / count << ", junctions "
+                  << junctions / count << ", river factor " << river / count << std::endl;
+        std::cout << "corridor lengths:";
+        for (size_t i = 0; i < corridors.size(); ++i) {
+            if (corridors[i] > 0) {
+                std::cout << " " << (1u << i) << "+:" << corridors[i];
+            }
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+
+    int runTrain(const Arguments& arguments) {
+        const std::string folder = arguments.positional.empty() ? "train_mazes" : arguments.positional;
+        const std::map<std::string, EvolutionMode> modes = {
+            {"generational", EvolutionMode::Generational},
+            {"steady", EvolutionMode::SteadyState},
+            {"mupluslambda", EvolutionMode::MuPlusLambda},
+            {"cmaes", EvolutionMode::CmaEs}
+        };
+        const auto mode = modes.find(arguments.get("mode", "generational"));
+        if (mode == modes.end()) {
+            std::cerr << "Unknown mode " << arguments.get("mode", "") << std::endl;
+            return 1;
+        }
+
+        const auto population = static_cast<size_t>(arguments.getInt("population", 100));
+        const auto generations = static_cast<size_t>(arguments.getInt("generations", 100));
+        GeneticAlgorithms ga(population, generations, 0.55f, 0.1f);
+        if (arguments.has("seed")) {
+            ga.setSeed(static_cast<uint64_t>(arguments.getInt("seed", 0)));
+        }
+        if (arguments.has("threads")) {
+            ga.setThreadCount(static_cast<size_t>(arguments.getInt("threads", 1)));
+        }
+        ga.setEvolutionMode(mode->second);
+        ga.setCurriculum(arguments.has("curriculum"));
+        //--novelty on its own is pure novelty search, a weight under 1 mixes the maze score back in
+        ga.setNoveltySearch(arguments.has("novelty"), std::stof(arguments.get("novelty", "1")));
+        const std::string checkpoint = arguments.get("checkpoint", "ga_checkpoint.bin");
+        ga.setCheckpointing(checkpoint, 10);
+        ga.setConsoleLogging(true, 2.0f);
+
+        std::signal(SIGINT, onInterrupt);
+        ga.setGenerationCallback([](const GenerationStats&) {return interrupted == 0;});
+
+        if (hasFilter(arguments)) {
+            //the index says which mazes pass, only those get read
+            std::vector<MazeAnalytics::IndexEntry> entries;
+            const std::unique_ptr<ThreadPool> pool = makePool(arguments);
+            if (!MazeAnalytics::indexFolder(folder, entries, pool.get())) {
+                return 1;
+            }
+            ga.loadMazes(MazeAnalytics::select(folder, entries, parseFilter(arguments)));
+        }
+        else {
+            ga.loadMazes(folder);
+        }
+        if (ga.getMazes().empty()) {
+            std::cerr << "No mazes in " << folder << ", nothing to train on" << std::endl;
+            return 1;
+        }
+        if (arguments.has("resume")) {
+            if (!ga.resume(checkpoint)) {
+                return 1;
+            }
+        }
+        else {
+            ga.train();
+        }
+        ga.saveBestChromosome(arguments.get("out", "best_chromosome.bin"));
+        return 0;
+    }
+
+    struct BenchResult {
+        std::string name;
+        double nanoseconds; //per iteration
+    };
+
+    //same layout as google benchmark's json so bench/compare.py can diff two runs (e.g. pgo vs not)
+    bool writeBenchJson(const std::string& fileName, const std::vector<BenchResult>& results) {
+        std::ofstream file(fileName);
+        if (!file) {
+            std::cerr << "Error opening file for writing: " << fileName << std::endl;
+            return false;
+        }
+        file << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            file << "    {\"name\": \"" << results[i].name << "\", \"run_name\": \"" << results[i].name
+                 << "\", \"run_type\": \"iteration\", \"real_time\": " << results[i].nanoseconds
+                 << ", \"cpu_time\": " << results[i].nanoseconds << ", \"time_unit\": \"ns\"}"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+        return true;
+    }
+
+    //rough timings of the hot paths without pulling in google benchmark, the bench/ target is the real one.
+    //fixed seeds throughout so two builds run exactly the same work, each number is the median of --runs
+    int runBench(const Arguments& arguments) {
+        const auto size = static_cast<int>(arguments.getInt("size", 64));
+        const auto repeat = std::max<long long>(arguments.getInt("repeat", 20), 1);
+        const auto runs = std::max<long long>(arguments.getInt("runs", 1), 1);
+        if (size < 1) {
+            std::cerr << "Maze size must be positive" << std::endl;
+            return 1;
+        }
+        std::vector<BenchResult> results;
+        //body returns how many items it did, the result is ns per item
+        auto measure = [&](const std::string& name, const std::function<long long()>& body) {
+            std::vector<double> times;
+            for (long long run = 0; run < runs; ++run) {
+                const auto start = std::chrono::steady_clock::now();
+                const long long items = std::max(body(), 1LL);
+                times.push_back(secondsSince(start) * 1e9 / static_cast<double>(items));
+            }
+            std::ranges::nth_element(times, times.begin() + times.size() / 2);
+            results.push_back({name, times[times.size() / 2]});
+        };
+        const std::string suffix = "/" + std::to_string(size);
+
+        Generator generator(size, size, 12345);
+        measure("generate" + suffix, [&] {
+            for (long long i = 0; i < repeat; ++i) {
+                generator.generateMaze();
+            }
+            return repeat;
+        });
+        //same size carved in 256x256 tiles over every core, a different maze so it's timed on its own generator
+        {
+            Generator tiled(size, size, 12345);
+            ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            measure("generate_tiled" + suffix, [&] {
+                for (long long i = 0; i < repeat; ++i) {
+                    tiled.generateMazeTiled(256, &pool);
+                }
+                return repeat;
+            });
+        }
+
+        const Maze& maze = generator.getMaze();
+        SolverAgent solver(generator.getHandle());
+        solver.setGoalPosition(size - 1, size - 1);
+        measure("solve" + suffix, [&] {
+            for (long long i = 0; i < repeat; ++i) {
+                solver.solve();
+            }
+            return repeat;
+        });
+        //one random wall flipped, then the path repaired. its own copy of the maze so the edits don't copy it
+        {
+            IncrementalSolver replanner{MazeHandle(maze)};
+            replanner.solve();
+            RandomStream rng(12345);
+            measure("replan" + suffix, [&] {
+                for (long long i = 0; i < repeat * 100; ++i) {
+                    const WallEdit edit{static_cast<int>(rng() % size), static_cast<int>(rng() % size),
+                                        static_cast<int>(rng() % 4), rng.nextBool()};
+                    replanner.applyEdits({&edit, 1});
+                    replanner.solve();
+                }
+                return repeat * 100;
+            });
+        }
+
+        //random policies, same gene spread as initPopulation. reported per step
+        const PreparedMaze prepared = RolloutKernel::prepare(maze);
+        measure("rollout_step" + suffix, [&] {
+            long long steps = 0;
+            for (long long i = 0; i < repeat * 100; ++i) {
+                RandomStream rng(12345, 0, i);
+                std::vector<float> genes(GeneticAlgorithms::getNumGenes());
+                for (auto& gene : genes) {
+                    gene = rng.nextFloat() * 2.0f - 1.0f;
+                }
+                const CompiledPolicy policy = RolloutKernel::compile(genes.data());
+                steps += RolloutKernel::run(prepared, policy, rng, GeneticAlgorithms::getMaxSteps()).steps;
+            }
+            return steps;
+        });
+
+        //one generation of scoring on a small training set, single threaded so the numbers are stable
+        GeneticAlgorithms ga(100, 1, 0.55f, 0.1f, 12345);
+        ga.setThreadCount(1);
+        std::vector<Maze> mazes;
+        for (uint64_t i = 0; i < 20; ++i) {
+            Generator trainingMaze(8, 8, 12345 + i);
+            trainingMaze.generateMaze();
+            mazes.push_back(trainingMaze.getMaze());
+        }
+        ga.setMazes(std::move(mazes));
+        ga.initPopulation(100);
+        measure("evaluate_generation/8", [&] {
+            for (long long i = 0; i < repeat; ++i) {
+                ga.evaluateChromosomes();
+            }
+            return repeat;
+        });
+
+        //k nearest in a novelty archive of 10^5 behaviours, per query
+        {
+            constexpr size_t dimensions = 18;
+            constexpr size_t archiveSize = 100000;
+            RandomStream rng(12345);
+            std::vector<float> behaviours(archiveSize * dimensions);
+            for (float& value : behaviours) {
+                value = rng.nextFloat();
+            }
+            NoveltyArchive archive(dimensions);
+            archive.add(behaviours.data(), archiveSize);
+            std::vector<float> distances;
+            measure("novelty_query/100000", [&] {
+                for (long long i = 0; i < repeat * 100; ++i) {
+                    archive.nearest(behaviours.data() + i * 7919 % archiveSize * dimensions, 15, distances);
+                }
+                return repeat * 100;
+            });
+        }
+
+        for (const auto& result : results) {
+            std::cout << result.name << ": " << result.nanoseconds / 1000.0 << " us" << std::endl;
+        }
+        if (arguments.has("json") && !writeBenchJson(arguments.get("json", "bench.json"), results)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    void printUsage() {
+        std::cerr << "usage: mazecli <generate|solve|train|stats|bench> [args]" << std::endl;
+        std::cerr << "  generate <folder> [--count N] [--width N] [--height N] [--seed N] [--tile N] [--threads N]"
+                  << std::endl;
+        std::cerr << "           [--duplicates] [--symmetric]" << std::endl;
+        std::cerr << "  solve <maze.mz or folder> [--genes file]" << std::endl;
+        std::cerr << "  train <folder> [--population N] [--generations N] [--mode generational|steady|mupluslambda|cmaes]"
+                  << std::endl;
+        std::cerr << "        [--threads N] [--seed N] [--out file] [--checkpoint file] [--resume] [--curriculum]"
+                  << std::endl;
+        std::cerr << "        [--novelty [weight]] [--min-solution N] [--max-solution N] [--perfect]" << std::endl;
+        std::cerr << "  stats <folder> [--min-solution N] [--max-solution N] [--perfect] [--list] [--symmetric]"
+                  << std::endl;
+        std::cerr << "        [--threads N]" << std::endl;
+        std::cerr << "  bench [--size N] [--repeat N] [--runs N] [--json file]" << std::endl;
+        std::cerr << "  any command: [--trace trace.json]" << std::endl;
+    }
+}
+
+int main(const int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    const std::string command = argv[1];
+    const Arguments arguments = parseArguments(argc, argv);
+    PROFILE_THREAD_NAME("main");
+    int result = 1;
+    try {
+        if (command == "generate") result = runGenerate(arguments);
+        else if (command == "solve") result = runSolve(arguments);
+        else if (command == "train") result = runTrain(arguments);
+        else if (command == "stats") result = runStats(arguments);
+        else if (command == "bench") result = runBench(arguments);
+        else printUsage();
+    }
+    catch (const std::exception& e) {
+        //only the number parsing throws here
+        std::cerr << "Bad argument: " << e.what() << std::endl;
+        return 1;
+    }
+    if (arguments.has("trace") && Profiler::writeChromeTrace(arguments.get("trace", "trace.json"))) {
+        std::cout << "Trace written to " << arguments.get("trace", "trace.json") << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+# profile guided build of mazecli, plus a plain build of the same config to compare against.
+#
+#   tools/pgo.sh                    # everything: instrumented build, workload, pgo rebuild, reference build, compare
+#   PGO_GENERATIONS=50 tools/pgo.sh # shorter workload
+#
+# the workload is a cut down training session: generate a training set, train a few generations in each mode
+# and batch solve with A*. that covers the rollout loop in evaluate and the A* loop in solve, the two
+# branchy hot paths. output: build-pgo/bin/mazecli (optimised) and build-nopgo/bin/mazecli (reference)
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+PGO_BUILD="${PGO_BUILD:-$ROOT/build-pgo}"
+REF_BUILD="${REF_BUILD:-$ROOT/build-nopgo}"
+PROFILE_DIR="$PGO_BUILD/pgo-profiles"
+WORK_DIR="$PGO_BUILD/pgo-workload"
+GENERATIONS="${PGO_GENERATIONS:-200}"
+JOBS="${JOBS:-$(nproc 2>/dev/null || echo 4)}"
+# anything else (e.g. -DMAZE_ENABLE_LTO=ON -DMAZE_MARCH=native) goes to both builds so the comparison is fair
+EXTRA_ARGS=("$@")
+COMMON_ARGS=(-DCMAKE_BUILD_TYPE=Release -DMAZE_BUILD_GUI=OFF -DMAZE_BUILD_TOOLS=ON "${EXTRA_ARGS[@]}")
+
+configure_and_build() {
+    local dir="$1"; shift
+    cmake -S "$ROOT" -B "$dir" "${COMMON_ARGS[@]}" "$@"
+    cmake --build "$dir" --target mazecli -j"$JOBS"
+}
+
+run_workload() {
+    local cli="$1"
+    rm -rf "$WORK_DIR"
+    mkdir -p "$WORK_DIR"
+    cd "$WORK_DIR"
+    # mix of sizes so the profile isn't tuned to one maze shape
+    "$cli" generate train_5 --count 200 --width 5 --height 5 --seed 1
+    "$cli" generate train_12 --count 100 --width 12 --height 12 --seed 2
+    "$cli" generate solve_64 --count 100 --width 64 --height 64 --seed 3
+    "$cli" train train_5 --population 100 --generations "$GENERATIONS" --seed 4 --checkpoint ck.bin --out best.bin
+    "$cli" train train_12 --mode steady --population 100 --generations "$GENERATIONS" --seed 5 --checkpoint ck.bin --out best.bin
+    "$cli" train train_5 --mode cmaes --population 14 --generations "$GENERATIONS" --seed 6 --checkpoint ck.bin --out best.bin
+    "$cli" solve solve_64 || true # exit code 2 only means some maze had no path
+    "$cli" bench --size 64 --repeat 20
+    cd "$ROOT"
+}
+
+echo "== instrumented build"
+rm -rf "$PROFILE_DIR"
+configure_and_build "$PGO_BUILD" -DMAZE_PGO=GENERATE -DMAZE_PGO_DIR="$PROFILE_DIR"
+
+echo "== workload"
+run_workload "$PGO_BUILD/bin/mazecli"
+
+# clang writes raw profiles that need merging, gcc reads its .gcda files straight from the folder
+if compgen -G "$PROFILE_DIR/*.profraw" > /dev/null; then
+    LLVM_PROFDATA="${LLVM_PROFDATA:-$(command -v llvm-profdata || xcrun -f llvm-profdata)}"
+    "$LLVM_PROFDATA" merge -o "$PROFILE_DIR/merged.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+echo "== optimised build"
+configure_and_build "$PGO_BUILD" -DMAZE_PGO=USE -DMAZE_PGO_DIR="$PROFILE_DIR"
+
+echo "== reference build"
+configure_and_build "$REF_BUILD" -DMAZE_PGO=OFF
+
+echo "== comparing"
+"$REF_BUILD/bin/mazecli" bench --size 64 --repeat 50 --runs 5 --json "$REF_BUILD/bench_nopgo.json"
+"$PGO_BUILD/bin/mazecli" bench --size 64 --repeat 50 --runs 5 --json "$PGO_BUILD/bench_pgo.json"
+# negative change = pgo is faster. never fails the script, a slower pgo build is worth seeing but not an error
+python3 "$ROOT/bench/compare.py" "$REF_BUILD/bench_nopgo.json" "$PGO_BUILD/bench_pgo.json" --threshold 1000 || true